@@ -0,0 +1,273 @@
+#pragma once
+#ifndef DSY_LOOPARENA_H
+#define DSY_LOOPARENA_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Fixed-capacity allocator that hands out loop memory per track from one region, usually all of SDRAM.
+Each track is a LoopBufferView (see loopbuffer.h). Instead of every track reserving its worst case,
+a track records into the largest free gap, is trimmed to the length it actually recorded, and gives
+its memory back when it is cleared. CompactStep() slides the remaining tracks down, a bounded number
+of bytes per call, so the freed gaps merge into room for a new long loop.
+
+declaration example: (4 tracks sharing 48MB of SDRAM)
+
+typedef LoopBufferView<float> Track;
+static uint8_t DSY_SDRAM_BSS pool[48 * 1024 * 1024];
+LoopArena<Track, 4> arena;
+Track tracks[4];
+
+arena.Init(pool, sizeof(pool));
+arena.AllocateLargest(0, &tracks[0]);   //start recording track 0
+...
+arena.Trim(0);                          //recording done, keep only the loop
+...
+arena.CompactStep(4096);                //once per audio block
+
+A track is not readable while it is being moved: mute it while IsMoving(track) is true,
+or only compact between takes.
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t max_tracks>
+class LoopArena
+{
+  public:
+    static const size_t kAlign = 8; //every region starts on an 8 byte boundary
+    static const size_t kNone  = SIZE_MAX;
+
+    LoopArena() {}
+    ~LoopArena() {}
+
+    /** takes over bytes bytes of memory, with no track allocated
+    */
+    void Init(void* memory, size_t bytes)
+    {
+        //align the start, and round the size down to whole alignment units
+        uintptr_t base  = reinterpret_cast<uintptr_t>(memory);
+        size_t    skip  = (kAlign - (base & (kAlign - 1))) & (kAlign - 1);
+        base_           = static_cast<uint8_t*>(memory) + skip;
+        bytes_          = bytes > skip ? (bytes - skip) & ~(kAlign - 1) : 0;
+        moving_         = kNone;
+        move_dst_       = 0;
+        move_done_      = 0;
+        for (size_t t = 0; t < max_tracks; t++) {
+            tracks_[t].buffer  = NULL;
+            tracks_[t].offset  = 0;
+            tracks_[t].bytes   = 0;
+            tracks_[t].samples = 0;
+        }
+    }
+
+    /** gives track room for samples samples in the first gap that fits, and attaches buffer to it with InitLazy().
+     *  Returns false if the track is taken or no gap is large enough.
+    */
+    bool Allocate(size_t track, Buffer* buffer, size_t samples)
+    {
+        if (track >= max_tracks || tracks_[track].buffer != NULL || samples == 0) {
+            return false;
+        }
+        size_t bytes = RoundUp(Buffer::GetBytes(samples));
+        size_t offset, size;
+        for (size_t start = 0; NextGap(start, offset, size); start = offset + size) {
+            if (size >= bytes) {
+                Take(track, buffer, offset, samples);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** gives track the largest free gap, for recording a loop whose length is not known yet.
+     *  Call Trim() once the recording is done. Returns false if the track is taken or nothing is free.
+    */
+    bool AllocateLargest(size_t track, Buffer* buffer)
+    {
+        if (track >= max_tracks || tracks_[track].buffer != NULL) {
+            return false;
+        }
+        size_t offset, size, best = 0, best_size = 0;
+        for (size_t start = 0; NextGap(start, offset, size); start = offset + size) {
+            if (size > best_size) {
+                best      = offset;
+                best_size = size;
+            }
+        }
+        size_t samples = best_size / Buffer::GetBytes(1);
+        if (samples == 0) {
+            return false;
+        }
+        Take(track, buffer, best, samples);
+        return true;
+    }
+
+    /** shrinks a track to the loop it holds, Buffer::GetLoopLength() samples, and frees the rest.
+     *  Returns false if the track is not allocated or is being moved.
+    */
+    bool Trim(size_t track)
+    {
+        if (track >= max_tracks || tracks_[track].buffer == NULL || track == moving_) {
+            return false;
+        }
+        Track& t = tracks_[track];
+        size_t samples = t.buffer->GetLoopLength();
+        samples        = samples < t.samples ? samples : t.samples;
+        t.samples      = samples;
+        t.bytes        = RoundUp(Buffer::GetBytes(samples));
+        t.buffer->Move(base_ + t.offset, samples);
+        return true;
+    }
+
+    /** frees the memory of a track, cancelling its move if one is running. The buffer must not be used afterwards.
+    */
+    void Release(size_t track)
+    {
+        if (track >= max_tracks) {
+            return;
+        }
+        if (track == moving_) {
+            moving_ = kNone;
+        }
+        tracks_[track].buffer = NULL;
+    }
+
+    /** closes the lowest gap by moving the track above it down, at most maxBytes per call.
+     *  Returns the number of bytes moved, 0 once the arena is compact.
+    */
+    size_t CompactStep(size_t maxBytes)
+    {
+        if (moving_ == kNone) {
+            //find the lowest track with a gap below it
+            size_t end = 0;
+            for (size_t t = Above(0); t != kNone; t = Above(end)) {
+                if (tracks_[t].offset > end) {
+                    moving_    = t;
+                    move_dst_  = end;
+                    move_done_ = 0;
+                    break;
+                }
+                end = tracks_[t].offset + tracks_[t].bytes;
+            }
+            if (moving_ == kNone) {
+                return 0;
+            }
+        }
+        Track& t = tracks_[moving_];
+        size_t k = t.bytes - move_done_;
+        k        = k < maxBytes ? k : maxBytes;
+        //front to back, so the chunks below never overwrite bytes still to be copied
+        memmove(base_ + move_dst_ + move_done_, base_ + t.offset + move_done_, k);
+        move_done_ += k;
+        if (move_done_ == t.bytes) {
+            t.offset = move_dst_;
+            t.buffer->Move(base_ + t.offset, t.samples);
+            moving_ = kNone;
+        }
+        return k;
+    }
+
+    /** returns true while CompactStep() is moving the track, its buffer must not be read or written meanwhile */
+    inline bool IsMoving(size_t track) const { return track == moving_; }
+
+    /** returns the number of bytes not held by any track */
+    size_t GetFreeBytes() const
+    {
+        size_t used = 0;
+        for (size_t t = 0; t < max_tracks; t++) {
+            if (tracks_[t].buffer != NULL) {
+                used += tracks_[t].bytes;
+            }
+        }
+        return bytes_ - used;
+    }
+
+    /** returns the size in bytes of the largest gap, the longest loop Allocate() can place right now */
+    size_t GetLargestFree() const
+    {
+        size_t offset, size, best = 0;
+        for (size_t start = 0; NextGap(start, offset, size); start = offset + size) {
+            best = size > best ? size : best;
+        }
+        return best;
+    }
+
+  private:
+    struct Track
+    {
+        Buffer* buffer; //NULL when the track has no memory
+        size_t  offset;
+        size_t  bytes;
+        size_t  samples;
+    };
+
+    static inline size_t RoundUp(size_t bytes) { return (bytes + kAlign - 1) & ~(kAlign - 1); }
+
+    inline void Take(size_t track, Buffer* buffer, size_t offset, size_t samples)
+    {
+        Track& t  = tracks_[track];
+        t.buffer  = buffer;
+        t.offset  = offset;
+        t.samples = samples;
+        t.bytes   = RoundUp(Buffer::GetBytes(samples));
+        buffer->InitLazy(base_ + offset, samples);
+    }
+
+    /** the bytes a track holds, a track being moved holds both its old and its new place */
+    inline void Extent(size_t t, size_t& lo, size_t& hi) const
+    {
+        lo = t == moving_ ? move_dst_ : tracks_[t].offset;
+        hi = tracks_[t].offset + tracks_[t].bytes;
+    }
+
+    /** returns the allocated track with the lowest start at or above position, or kNone */
+    size_t Above(size_t position) const
+    {
+        size_t best = kNone, best_lo = SIZE_MAX;
+        for (size_t t = 0; t < max_tracks; t++) {
+            size_t lo, hi;
+            if (tracks_[t].buffer == NULL) {
+                continue;
+            }
+            Extent(t, lo, hi);
+            if (lo >= position && lo < best_lo) {
+                best    = t;
+                best_lo = lo;
+            }
+        }
+        return best;
+    }
+
+    /** finds the first gap at or above start, returns false when there is none */
+    bool NextGap(size_t start, size_t& offset, size_t& size) const
+    {
+        while (start < bytes_) {
+            size_t t = Above(start);
+            size_t lo, hi;
+            if (t == kNone) {
+                lo = bytes_;
+                hi = bytes_;
+            } else {
+                Extent(t, lo, hi);
+            }
+            if (lo > start) {
+                offset = start;
+                size   = lo - start;
+                return true;
+            }
+            start = hi;
+        }
+        return false;
+    }
+
+    uint8_t* base_;
+    size_t   bytes_;
+    Track    tracks_[max_tracks];
+    size_t   moving_;    //track CompactStep() is moving, kNone when idle
+    size_t   move_dst_;  //where it is going
+    size_t   move_done_; //bytes already copied
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,205 @@
+#pragma once
+#ifndef DSY_LOOPBANK_H
+#define DSY_LOOPBANK_H
+#include <stdlib.h>
+#include <stdint.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Several LoopBuffer tracks played, overdubbed and mixed together in one pass, on a shared transport.
+Processing each track on its own walks the block once per track for the read and once more for the
+overdub, and repeats the position bookkeeping in every call. LoopBank keeps the state of every track
+in parallel arrays (structure of arrays) and works through the block in short chunks. Within a
+chunk, every track touches its span of the loop once, through LoopBuffer::MixSpan(). That call mixes
+the span into the output and, when overdubbing, blends the input into it in the same pass. The input
+and output chunks stay in cache for all the tracks, and each track's state is loaded into registers
+once per chunk.
+
+All tracks follow one transport. Each track's position is the transport time modulo its own length,
+so tracks of related lengths (a 2 bar loop over an 8 bar loop) stay aligned, and Restart() brings
+them back to their starts together.
+
+The tracks can be any LoopBuffer or LoopBufferView, for instance ones placed by LoopArena.
+Record new loops with the buffer itself or LoopSchedule, then Attach() or Sync() the track.
+
+declaration example: (4 tracks)
+
+typedef LoopBuffer<float, SAMPLE_RATE * 30> Track;
+Track DSY_SDRAM_BSS tracks[4];
+LoopBank<Track, 4> bank;
+
+bank.Init();
+bank.Attach(0, &tracks[0]);
+bank.SetMode(0, bank.OVERDUB);
+...
+bank.Process(in, out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t max_tracks>
+class LoopBank
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    /** what a track does during Process() */
+    enum Mode
+    {
+        MUTE,    //silent, but the position keeps following the transport
+        PLAY,    //mixed into the output
+        OVERDUB, //mixed into the output, and the input is blended into the loop
+    };
+
+    LoopBank() {}
+    ~LoopBank() {}
+
+    /** empties the bank and stops the transport at time 0 */
+    void Init()
+    {
+        for (size_t t = 0; t < max_tracks; t++) {
+            buffer_[t]   = NULL;
+            pos_[t]      = 0;
+            length_[t]   = 1;
+            gain_[t]     = 1.f;
+            feedback_[t] = 1.f;
+            input_[t]    = 1.f;
+            mode_[t]     = MUTE;
+        }
+        time_    = 0;
+        running_ = false;
+    }
+
+    /** puts a buffer on a track, in PLAY mode and aligned to the transport. NULL removes the track. */
+    void Attach(size_t track, Buffer* buffer)
+    {
+        if (track >= max_tracks) {
+            return;
+        }
+        buffer_[track] = buffer;
+        mode_[track]   = buffer != NULL ? PLAY : MUTE;
+        Sync(track);
+    }
+
+    /** puts a track back in line with the transport, after its loop length changed */
+    inline void Sync(size_t track)
+    {
+        if (track < max_tracks && buffer_[track] != NULL) {
+            size_t length  = buffer_[track]->GetLoopLength();
+            length_[track] = length > 0 ? length : 1;
+            pos_[track]    = time_ % length_[track];
+        }
+    }
+
+    inline void SetMode(size_t track, Mode mode)
+    {
+        if (track < max_tracks) {
+            mode_[track] = buffer_[track] != NULL ? mode : MUTE;
+        }
+    }
+
+    /** sets the gain a track is mixed with */
+    inline void SetGain(size_t track, float gain)
+    {
+        if (track < max_tracks) {
+            gain_[track] = gain;
+        }
+    }
+
+    /** sets the overdub mix of a track: loop = loop * feedback + input * inputGain */
+    inline void SetOverdub(size_t track, float feedback, float inputGain)
+    {
+        if (track < max_tracks) {
+            feedback_[track] = feedback;
+            input_[track]    = inputGain;
+        }
+    }
+
+    /** starts or stops the transport. While stopped, Process() outputs silence and nothing moves. */
+    inline void Start() { running_ = true; }
+    inline void Stop() { running_ = false; }
+
+    /** moves the transport back to 0, every track to the start of its loop */
+    void Restart()
+    {
+        time_ = 0;
+        for (size_t t = 0; t < max_tracks; t++) {
+            pos_[t] = 0;
+        }
+    }
+
+    /** returns the transport time in samples */
+    inline size_t GetTime() const { return time_; }
+
+    /** returns the position of a track within its loop */
+    inline size_t GetPosition(size_t track) const { return track < max_tracks ? pos_[track] : 0; }
+
+    /** plays every track into out, and overdubs in into the tracks in OVERDUB mode.
+     *  in may be NULL when no track overdubs.
+    */
+    void Process(const T* in, T* out, size_t n)
+    {
+        LoopKernelClear(out, n);
+        if (!running_) {
+            return;
+        }
+        //a loop may have been shortened since the last block
+        for (size_t t = 0; t < max_tracks; t++) {
+            if (buffer_[t] != NULL && buffer_[t]->GetLoopLength() != length_[t]) {
+                Sync(t);
+            }
+        }
+        for (size_t i = 0; i < n; i += kChunk) {
+            size_t k = n - i < kChunk ? n - i : kChunk;
+            for (size_t t = 0; t < max_tracks; t++) {
+                if (buffer_[t] == NULL) {
+                    continue;
+                }
+                if (mode_[t] == MUTE) {
+                    pos_[t] = LoopAdvance(pos_[t], static_cast<int32_t>(k), length_[t]);
+                    continue;
+                }
+                const T* src = mode_[t] == OVERDUB ? in : NULL;
+                pos_[t]      = Track(t, src != NULL ? src + i : NULL, out + i, k);
+            }
+        }
+        time_ += n;
+    }
+
+  private:
+    static const size_t kChunk = 64; //samples every track works through before the next track
+
+    /** plays k samples of one track into out, overdubbing in when it is not NULL. Returns the new position. */
+    inline size_t Track(size_t t, const T* in, T* out, size_t k)
+    {
+        Buffer*      b      = buffer_[t];
+        size_t       pos    = pos_[t];
+        const size_t length = length_[t];
+        const float  gain   = gain_[t];
+        const float  fb     = feedback_[t];
+        const float  ig     = input_[t];
+        while (k > 0) {
+            size_t m = length - pos;
+            m        = m < k ? m : k;
+            b->MixSpan(pos, out, m, gain, in, fb, ig);
+            in  = in != NULL ? in + m : NULL;
+            pos = pos + m < length ? pos + m : 0;
+            out += m;
+            k -= m;
+        }
+        return pos;
+    }
+
+    //one entry per track
+    Buffer* buffer_[max_tracks];   //NULL when the track is empty
+    size_t  pos_[max_tracks];      //position in the loop, the transport time modulo length_
+    size_t  length_[max_tracks];
+    float   gain_[max_tracks];
+    float   feedback_[max_tracks];
+    float   input_[max_tracks];
+    Mode    mode_[max_tracks];
+
+    size_t time_;
+    bool   running_;
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,317 @@
+#pragma once
+#ifndef DSY_LOOPBENCH_H
+#define DSY_LOOPBENCH_H
+#include <stdlib.h>
+#include <stdint.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Tick source for LoopBench, the clock shared with the instrumentation (see loopstats.h).
+Results are in CPU cycles on the Cortex-M7 and in nanoseconds on the host.
+*/
+typedef LoopClock LoopBenchClock;
+
+/** cost of one LoopBuffer API at one loop length and block size */
+struct LoopBenchResult
+{
+    const char* name;
+    size_t      loop_length;
+    size_t      block_size;
+    float       ticks_per_sample; //in LoopBenchClock::Unit()
+};
+
+/** Benchmark harness for every LoopBuffer read/write mode.
+
+Each API is driven for a fixed number of samples in blocks of block_size, the way the audio
+callback would call it: per-sample APIs are called block_size times per block, block APIs once.
+Splice is timed per faded sample. Run this from the main loop with audio stopped:
+
+static LoopBuffer<float, 1 << 20> DSY_SDRAM_BSS loop;
+LoopBench<LoopBuffer<float, 1 << 20>> bench;
+LoopBenchResult results[LoopBench<LoopBuffer<float, 1 << 20>>::kNumTests];
+
+bench.Init(&loop, 48000);
+size_t n = bench.Run(48000, 48, results);
+for (size_t i = 0; i < n; i++)
+    hw.PrintLine("%s %u " FLT_FMT3, results[i].name, results[i].block_size, FLT_VAR3(results[i].ticks_per_sample));
+
+The buffer's contents are overwritten.
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer>
+class LoopBench
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    enum Test
+    {
+        WRITE,
+        WRITE_BLOCK,
+        OVERDUB,
+        OVERDUB_BLOCK,
+        READ,
+        READ_BLOCK,
+        READ_ONCE,
+        READ_ONCE_BLOCK,
+        READ_CLIP_END,
+        READ_CLIP_END_BLOCK,
+        READ_CLIP,
+        READ_CLIP_BLOCK,
+        READ_CLIP_SET,
+        READ_CLIP_SET_BLOCK,
+        READ_RANDOM,
+        READ_RANDOM_BLOCK,
+        READ_SPEED_CLIP,
+        READ_SPEED_CLIP_BLOCK,
+        READ_SPEED,
+        READ_SPEED_BLOCK,
+        READ_REVERSE,
+        READ_REVERSE_BLOCK,
+        READ_PING_PONG,
+        READ_PING_PONG_BLOCK,
+        READ_SPEED_REVERSE,
+        READ_SPEED_REVERSE_BLOCK,
+        READ_PHASE,
+        READ_PHASE_BLOCK,
+        SPLICE,
+        SPLICE_RANGE,
+        TEST_LAST,
+    };
+
+    static const size_t kNumTests = TEST_LAST;
+    static const size_t kMaxBlock = 256;
+
+    LoopBench() {}
+    ~LoopBench() {}
+
+    /** attaches the harness to a buffer
+     *  size_t samples - number of samples each API is driven for per measurement
+    */
+    void Init(Buffer* buffer, size_t samples)
+    {
+        buffer_  = buffer;
+        samples_ = samples > 0 ? samples : 1;
+        LoopBenchClock::Init();
+        for (size_t i = 0; i < kMaxBlock; i++) {
+            //deterministic, non-trivial input
+            input_[i] = static_cast<T>(static_cast<float>((i * 7919u) % 2003u) / 1001.5f - 1.f);
+        }
+    }
+
+    /** measures every API at one loop length and block size, and writes one result per test.
+     *  Block sizes above kMaxBlock are clamped. Returns the number of results written.
+    */
+    size_t Run(size_t loopLength, size_t blockSize, LoopBenchResult* results)
+    {
+        blockSize = blockSize < 1 ? 1 : (blockSize > kMaxBlock ? kMaxBlock : blockSize);
+        size_t n  = 0;
+        for (size_t t = 0; t < kNumTests; t++) {
+            //Splice() always fades kSpliceFade samples at each end
+            if (t == SPLICE && loopLength <= 2 * kSpliceFade) {
+                continue;
+            }
+            Record(loopLength);
+            results[n].name             = Name(static_cast<Test>(t));
+            results[n].loop_length      = loopLength;
+            results[n].block_size       = blockSize;
+            results[n].ticks_per_sample = Measure(static_cast<Test>(t), loopLength, blockSize);
+            n++;
+        }
+        return n;
+    }
+
+    /** returns a printable name for a test */
+    static const char* Name(Test t)
+    {
+        static const char* names[kNumTests] = {
+            "Write",
+            "WriteBlock",
+            "Overdub",
+            "OverdubBlock",
+            "Read",
+            "ReadBlock",
+            "ReadOnce",
+            "ReadOnceBlock",
+            "Read(clipEnd)",
+            "ReadBlock(clipEnd)",
+            "Read(clip)",
+            "ReadBlock(clip)",
+            "ReadClip",
+            "ReadClipBlock",
+            "Read(random clip)",
+            "ReadBlock(random clip)",
+            "Read(speed clip)",
+            "ReadBlock(speed clip)",
+            "ReadSpeed",
+            "ReadSpeedBlock",
+            "ReadReverse",
+            "ReadReverseBlock",
+            "ReadPingPong",
+            "ReadPingPongBlock",
+            "ReadSpeed(reverse)",
+            "ReadSpeedBlock(reverse)",
+            "ReadPhase",
+            "ReadPhaseBlock",
+            "Splice",
+            "Splice(range)",
+        };
+        return names[t];
+    }
+
+  private:
+    static const size_t kSpliceFade = Buffer::kSpliceFade;
+
+    /** records loopLength samples and rewinds, so every test starts from the same loop */
+    void Record(size_t loopLength)
+    {
+        buffer_->Reset();
+        for (size_t i = 0; i < loopLength; i += kMaxBlock) {
+            size_t k = loopLength - i < kMaxBlock ? loopLength - i : kMaxBlock;
+            buffer_->WriteBlock(input_, k);
+        }
+        buffer_->SetLength(loopLength);
+        buffer_->SetReadPosition(0);
+        buffer_->SetPhaseSpeed(kSpeed);
+        buffer_->SetClip(kClipStart, kClipEnd, kMinClip);
+    }
+
+    float Measure(Test t, size_t loopLength, size_t blockSize)
+    {
+        if (t == SPLICE || t == SPLICE_RANGE) {
+            size_t   fade  = t == SPLICE ? kSpliceFade : loopLength / 8;
+            uint32_t start = LoopBenchClock::Now();
+            if (t == SPLICE) {
+                buffer_->Splice();
+            } else {
+                buffer_->Splice(fade, 0, loopLength - 1);
+            }
+            uint32_t ticks = LoopBenchClock::Now() - start;
+            return fade > 0 ? static_cast<float>(ticks) / (2 * fade) : 0.f;
+        }
+
+        buffer_->GetHead().Seed(1);
+        size_t   done  = 0;
+        uint32_t start = LoopBenchClock::Now();
+        while (done < samples_) {
+            RunBlock(t, blockSize);
+            done += blockSize;
+        }
+        uint32_t ticks = LoopBenchClock::Now() - start;
+        return static_cast<float>(ticks) / done;
+    }
+
+    void RunBlock(Test t, size_t n)
+    {
+        T* out = output_;
+        switch (t) {
+            case WRITE:
+                for (size_t i = 0; i < n; i++) {
+                    buffer_->Write(input_[i]);
+                }
+                break;
+            case WRITE_BLOCK: buffer_->WriteBlock(input_, n); break;
+            case OVERDUB:
+                for (size_t i = 0; i < n; i++) {
+                    buffer_->Overdub(input_[i], kFeedback, 1.f);
+                }
+                break;
+            case OVERDUB_BLOCK: buffer_->Overdub(input_, n, kFeedback, 1.f); break;
+            case READ:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->Read();
+                }
+                break;
+            case READ_BLOCK: buffer_->ReadBlock(out, n); break;
+            case READ_ONCE:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadOnce();
+                }
+                break;
+            case READ_ONCE_BLOCK: buffer_->ReadOnceBlock(out, n); break;
+            case READ_CLIP_END:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->Read(kClipEnd, kMinClip);
+                }
+                break;
+            case READ_CLIP_END_BLOCK: buffer_->ReadBlock(out, n, kClipEnd, kMinClip); break;
+            case READ_CLIP:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->Read(kClipStart, kClipEnd, kMinClip);
+                }
+                break;
+            case READ_CLIP_BLOCK: buffer_->ReadBlock(out, n, kClipStart, kClipEnd, kMinClip); break;
+            case READ_CLIP_SET:
+                buffer_->UpdateClip();
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadClip();
+                }
+                break;
+            case READ_CLIP_SET_BLOCK: buffer_->ReadClipBlock(out, n); break;
+            case READ_RANDOM:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->Read(kClipStart, kClipEnd, kMinClip, true, true);
+                }
+                break;
+            case READ_RANDOM_BLOCK:
+                buffer_->ReadBlock(out, n, kClipStart, kClipEnd, kMinClip, true, true);
+                break;
+            case READ_SPEED_CLIP:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->Read(kClipStart, kClipEnd, kSpeed, kMinClip, false, false);
+                }
+                break;
+            case READ_SPEED_CLIP_BLOCK:
+                buffer_->ReadBlock(out, n, kClipStart, kClipEnd, kSpeed, kMinClip, false, false);
+                break;
+            case READ_SPEED:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadSpeed(kSpeed);
+                }
+                break;
+            case READ_SPEED_BLOCK: buffer_->ReadSpeedBlock(out, n, kSpeed); break;
+            case READ_REVERSE:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadReverse();
+                }
+                break;
+            case READ_REVERSE_BLOCK: buffer_->ReadReverseBlock(out, n); break;
+            case READ_PING_PONG:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadPingPong();
+                }
+                break;
+            case READ_PING_PONG_BLOCK: buffer_->ReadPingPongBlock(out, n); break;
+            case READ_SPEED_REVERSE:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadSpeed(-kSpeed);
+                }
+                break;
+            case READ_SPEED_REVERSE_BLOCK: buffer_->ReadSpeedBlock(out, n, -kSpeed); break;
+            case READ_PHASE:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = buffer_->ReadPhase();
+                }
+                break;
+            case READ_PHASE_BLOCK: buffer_->ReadPhaseBlock(out, n); break;
+            default: break;
+        }
+        //keep the reads from being optimized away
+        sink_ = out[n - 1];
+    }
+
+    static constexpr float kClipStart = 0.25f;
+    static constexpr float kClipEnd   = 0.5f;
+    static constexpr float kSpeed     = 1.37f;
+    static constexpr float kFeedback  = 0.8f;
+    static const size_t    kMinClip   = 64;
+
+    Buffer*    buffer_;
+    size_t     samples_;
+    T          input_[kMaxBlock];
+    T          output_[kMaxBlock];
+    volatile T sink_;
+};
+} // namespace daisysp
+#endif
@@ -3,8 +3,257 @@
 #define DSY_LOOP_H
 #include <stdlib.h>
 #include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include "loopinterp.h"
+#include "loopformat.h"
+#include "looprandom.h"
+#include "loopfade.h"
+#include "loopkernels.h"
+#include "loopstats.h"
 namespace daisysp
 {
+/** Wrap policy for LoopBuffer: compare-and-subtract.
+Works for any max_size and loop length. Wrap(x, n) expects x < 2 * n.
+*/
+struct LoopWrapCompare
+{
+    static constexpr bool kPowerOfTwo = false;
+
+    /** wraps a position into [0, n) */
+    static inline size_t Wrap(size_t x, size_t n) { return x < n ? x : x - n; }
+
+    /** wraps a position into [0, size) where size is the size of the buffer */
+    static inline size_t WrapBuffer(size_t x, size_t size) { return x < size ? x : x - size; }
+};
+
+/** Wrap policy for LoopBuffer: masks positions that wrap at the end of the buffer.
+max_size must be a power of two. Positions wrapping at the loop length still use compare-and-subtract.
+*/
+struct LoopWrapMask
+{
+    static constexpr bool kPowerOfTwo = true;
+
+    /** wraps a position into [0, n) */
+    static inline size_t Wrap(size_t x, size_t n) { return x < n ? x : x - n; }
+
+    /** wraps a position into [0, size) where size is the size of the buffer */
+    static inline size_t WrapBuffer(size_t x, size_t size) { return x & (size - 1); }
+};
+
+/** moves ptr by step samples (negative steps move backwards) and wraps it into [0, n) without dividing.
+The loops only run more than once for steps larger than n.
+*/
+inline size_t LoopAdvance(size_t ptr, int32_t step, size_t n)
+{
+    if (step >= 0) {
+        ptr += static_cast<size_t>(step);
+        while (ptr >= n) {
+            ptr -= n;
+        }
+    } else {
+        size_t back = static_cast<size_t>(-step);
+        while (back > ptr) {
+            ptr += n;
+        }
+        ptr -= back;
+    }
+    return ptr;
+}
+
+/** Clip window of a LoopHead, set at control rate by LoopBuffer::SetClip() and read by ReadClip().
+Keeps the knob values and the whole-sample offset and length they resolve to, so that the conversion
+runs once per block or when the loop length changes instead of on every sample.
+*/
+struct LoopClip
+{
+    float  start;     //target start, [0..1.0] of the loop
+    float  end;       //target length, [0..1.0] of the loop
+    float  start_now; //start the window has smoothed to so far
+    float  end_now;   //length the window has smoothed to so far
+    float  smooth;    //fraction of the way to the target covered per LoopBuffer::UpdateClip(), 1 jumps
+    size_t min;       //shortest clip in samples
+    size_t offset;    //start of the clip within the loop, in samples
+    size_t samples;   //length of the clip in samples
+    size_t length;    //loop length offset and samples were resolved for, 0 when they must be resolved again
+
+    LoopClip()
+    {
+        start     = 0.f;
+        end       = 1.f;
+        start_now = 0.f;
+        end_now   = 1.f;
+        smooth    = 1.f;
+        min       = 1;
+        offset    = 0;
+        samples   = 0;
+        length    = 0;
+    }
+};
+
+/** Linear ramp of a parameter, advanced one sample at a time by the block reads that use it.
+A new target starts a ramp of length samples from the current value, the last sample of the ramp lands
+exactly on the target. With length 0 every new target is taken at once.
+*/
+struct LoopRamp
+{
+    float  value;  //value at the last sample rendered
+    float  target;
+    float  step;   //change per sample while ramping
+    size_t left;   //samples until the target is reached, 0 when settled
+    size_t length; //samples a ramp takes
+
+    LoopRamp()
+    {
+        length = 0;
+        Jump(1.f);
+    }
+
+    /** moves to value at once, ending any ramp */
+    inline void Jump(float v)
+    {
+        value  = v;
+        target = v;
+        step   = 0.f;
+        left   = 0;
+    }
+
+    /** starts a ramp to t, unless t is already the target */
+    inline void Set(float t)
+    {
+        if (t == target) {
+            return;
+        }
+        if (length == 0) {
+            Jump(t);
+            return;
+        }
+        target = t;
+        step   = (t - value) / static_cast<float>(length);
+        left   = length;
+    }
+
+    /** advances one sample and returns the value for it */
+    inline float Next()
+    {
+        if (left > 0) {
+            left--;
+            value = left > 0 ? value + step : target;
+        }
+        return value;
+    }
+};
+
+/** Read position and clip state of one playhead over a LoopBuffer.
+Every LoopBuffer has one built in, additional heads can be passed to the Read overloads
+so that several voices play back the same recorded audio independently.
+*/
+struct LoopHead
+{
+    size_t read_ptr;    //position within the clip, in samples
+    float  frac;        //fractional position used by the variable speed reads
+    size_t clip_end;    //length of the current clip, drawn by the randomized reads
+    size_t clip_offset; //start of the current clip within the loop
+    uint32_t phase;     //fractional position used by ReadPhase, in 1/2^32 samples
+    int64_t  increment; //32.32 fixed-point speed used by ReadPhase
+    LoopRandom rng;     //draws the random clips of this head
+    size_t fade_len;    //length of the crossfade at clip boundaries, 0 disables it
+    float  fade_step;   //1 / fade_len
+    size_t fade_pos;    //samples into the current crossfade, fade_len when idle
+    size_t fade_tail;   //position in the loop of the previous clip, played out under the fade
+    size_t fade_next;   //where the read would continue if the clip did not jump
+    bool   reverse;     //direction of the ping-pong reads, true while they play backwards
+    LoopClip clip;      //window read by ReadClip(), see LoopBuffer::SetClip()
+    LoopRamp glide;     //speed of the speed block reads, ramped when SetSpeedRamp() is set
+
+    /** heads are seeded from their address so that voices differ by default, call Seed() for a
+     *  reproducible sequence
+    */
+    LoopHead()
+    {
+        fade_len  = 0;
+        fade_step = 0.f;
+        Reset();
+        Seed(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this)));
+    }
+
+    /** seeds the random clip generator of this head */
+    inline void Seed(uint32_t seed) { rng.Seed(seed); }
+
+    /** sets the length in samples of the crossfade played each time the clip wraps, 0 disables it.
+     *  Used by the speed clip reads.
+    */
+    inline void SetCrossfade(size_t length)
+    {
+        fade_len  = length;
+        fade_step = length > 0 ? 1.f / static_cast<float>(length) : 0.f;
+        fade_pos  = length;
+    }
+
+    /** sets how many samples the speed block reads take to glide to a new speed, 0 jumps at once.
+     *  Used by ReadSpeedBlock() and the speed clip reads, so knob moves do not step the pitch.
+    */
+    inline void SetSpeedRamp(size_t length) { glide.length = length; }
+
+    /** moves the head back to the start of the loop and forgets the current clip.
+     *  The random generator, the crossfade and speed ramp lengths and the SetClip() window are kept.
+     *  The speed glide restarts from normal speed.
+    */
+    void Reset()
+    {
+        read_ptr    = 0;
+        frac        = 0.f;
+        clip_end    = 0;
+        clip_offset = 0;
+        phase       = 0;
+        increment   = int64_t(1) << 32;
+        fade_pos    = fade_len;
+        fade_tail   = 0;
+        fade_next   = SIZE_MAX;
+        reverse     = false;
+        clip.length = 0;
+        glide.Jump(1.f);
+    }
+};
+
+/** Positions and length of a LoopBuffer and its own playhead, as saved by loopsnapshot.h.
+*/
+struct LoopBufferState
+{
+    size_t   length;      //loop length in whole samples
+    float    length_frac; //fractional part of a length set with Setlength()
+    size_t   write_ptr;
+    size_t   read_ptr;
+    float    read_frac;
+    uint32_t phase;
+    int64_t  increment;
+};
+
+/** Storage of a LoopBuffer: samples words per sample held inside the object.
+*/
+template <typename Word, size_t words, size_t samples>
+struct LoopStorage
+{
+    Word line[samples * words];
+
+    inline size_t Samples() const { return samples; }
+    inline size_t Bytes() const { return sizeof(line); }
+};
+
+/** Storage of a LoopBufferView: a caller-owned memory region, sized at runtime.
+*/
+template <typename Word, size_t words>
+struct LoopStorage<Word, words, 0>
+{
+    Word*  line;
+    size_t samples;
+
+    LoopStorage() : line(NULL), samples(0) {}
+
+    inline size_t Samples() const { return samples; }
+    inline size_t Bytes() const { return samples * words * sizeof(Word); }
+};
+
 /** Delay line buffer for looper applications.
 This is a modification of delayline.h in DaisySP library.
 March 2021
@@ -13,41 +262,157 @@ declaration example: (1 second of floats)
 
 LoopBuffer<float, SAMPLE_RATE> del;
 
+The optional WrapPolicy selects how positions wrap, none of the per-sample paths divide:
+
+LoopBuffer<float, 65536, LoopWrapMask> del;
+
+The optional InterpPolicy selects the interpolation used by the variable speed reads (see loopinterp.h):
+
+LoopBuffer<float, SAMPLE_RATE, LoopWrapCompare, LoopInterpSinc> del;
+
+The optional FormatPolicy selects how samples are stored (see loopformat.h), T stays the type read and written:
+
+LoopBuffer<float, SAMPLE_RATE, LoopWrapCompare, LoopInterpLinear, LoopFormatInt16> del;
+
+The optional StatsPolicy adds instrumentation (see loopstats.h). The default LoopStatsNone compiles to nothing,
+LoopStatsCounters counts random clips, clamps, wraps and fallbacks and times blocks, for GetStats():
+
+LoopBuffer<float, SAMPLE_RATE, LoopWrapCompare, LoopInterpLinear, LoopFormatNative<float>, LoopStatsCounters> del;
+
+A max_size of 0 (LoopBufferView) keeps no storage of its own and plays a memory region handed to Init() at
+runtime, so loops of any size can be carved out of one pool with a single instantiation:
+
+LoopBufferView<float> del;
+del.Init(memory, samples);
+
 By: Shahin Etemadzadeh
 */
-template <typename T, size_t max_size>
+template <typename T,
+          size_t max_size,
+          typename WrapPolicy   = LoopWrapCompare,
+          typename InterpPolicy = LoopInterpLinear,
+          typename FormatPolicy = LoopFormatNative<T>,
+          typename StatsPolicy  = LoopStatsNone>
 class LoopBuffer
 {
+    static_assert(!WrapPolicy::kPowerOfTwo || (max_size & (max_size - 1)) == 0,
+                  "LoopWrapMask requires a power of two max_size");
+
   public:
+    typedef T            SampleType;
+    typedef InterpPolicy InterpType;
+
+    typedef typename FormatPolicy::Word Word;
+
     LoopBuffer() {}
     ~LoopBuffer() {}
     /** initializes the buffer by clearing the values within, and setting length to 1 sample.
     */
-    void Init() { 
-        for(size_t i = 0; i < max_size; i++)
-        {
-            line_[i] = T(0);
+    void Init()
+    {
+        InterpPolicy::Prepare();
+        LoopFade::Prepare();
+        lazy_ = false;
+        Clear();
+        Reset();
+    }
+
+    /** attaches a LoopBufferView to samples samples of caller-owned memory, aligned for Word, and initializes it
+     *  like Init(). With LoopWrapMask the capacity is rounded down to a power of two.
+     *  The memory must hold GetBytes(samples) bytes and outlive the view.
+    */
+    void Init(void* memory, size_t samples)
+    {
+        Attach(memory, samples);
+        Init();
+    }
+
+    /** attaches a LoopBufferView to caller-owned memory like Init(memory, samples), without clearing it
+    */
+    void InitLazy(void* memory, size_t samples)
+    {
+        Attach(memory, samples);
+        InitLazy();
+    }
+
+    /** points a LoopBufferView at memory that already holds its samples, after they were moved or the region was
+     *  shrunk, without clearing anything. The length and positions are kept, clamped to the new capacity.
+    */
+    void Move(void* memory, size_t samples)
+    {
+        Attach(memory, samples);
+        size_t cap = Capacity();
+        length_    = length_ < cap ? length_ : cap;
+        valid_     = valid_ < cap ? valid_ : cap;
+        write_ptr_ = write_ptr_ < cap ? write_ptr_ : 0;
+        head_.read_ptr = head_.read_ptr < length_ ? head_.read_ptr : 0;
+        if (splice_.active && splice_.zero_end > cap) {
+            splice_.active = false;
         }
-        Reset(); 
     }
+
+    /** returns the number of bytes a LoopBufferView of samples samples needs */
+    static inline size_t GetBytes(size_t samples) { return samples * kWords * sizeof(Word); }
+
+    /** returns the most samples the buffer can hold */
+    inline size_t GetCapacity() const { return store_.Samples(); }
+
+    /** initializes the buffer without clearing it, for large buffers in SDRAM.
+     *  Samples are only cleared as the loop grows over them, so reads past the recorded
+     *  audio return silence and Reset() never has to touch the old contents.
+    */
+    void InitLazy()
+    {
+        InterpPolicy::Prepare();
+        LoopFade::Prepare();
+        lazy_  = true;
+        valid_ = 0;
+        Reset();
+    }
+
+    /** clears the whole buffer with a word-wide fill. Positions and length are kept.
+    */
+    void Clear()
+    {
+        memset(store_.line, 0, store_.Bytes());
+        valid_ = Capacity();
+    }
+
     /** sets write ptr and read ptr to 0, and length to 1 sample.
+     *  In lazy mode the previous recording is also dropped, in O(1).
     */
     void Reset()
     {
         write_ptr_  = 0;
-        read_ptr_   = 0;
         length_     = 1;
         frac_       = 0.f;
+        head_.Reset();
+        splice_.active = false;
+        if (lazy_) {
+            valid_ = 0;
+        }
+        Extend();
     }
 
+    /** returns the number of samples from the start of the buffer holding recorded audio or silence.
+     *  Always the capacity unless the buffer was initialized with InitLazy().
+    */
+    inline size_t GetValidLength() const { return valid_; }
+
     /** sets the buffer length time in samples
         If a float is passed in, a fractional component will be calculated for interpolating the delay line.
     */
     inline void SetLength(size_t length)
     {
+        if (length > Capacity()) {
+            stats_.OnLengthClamp();
+        }
         frac_  = 0.0f;
         //length_ = length < max_size ? length : max_size - 1;
-        length_ = length < max_size ? length : max_size;        //SE 2021116: Trying to fix overrun issues with Continuous Looper
+        length_ = length < Capacity() ? length : Capacity();        //SE 2021116: Trying to fix overrun issues with Continuous Looper
+        length_ = length_ > 0 ? length_ : 1;                    //a loop of 0 would divide by zero and stall the reads
+        Extend();
+        head_.read_ptr %= length_;                              //keep the read pointer on the loop so reads can wrap without dividing
     }
 
     /** sets the buffer length time in samples
@@ -56,9 +421,15 @@ class LoopBuffer
     inline void Setlength(float length)
     {
         int32_t int_length = static_cast<int32_t>(length);
+        if (static_cast<size_t>(int_length) >= Capacity()) {
+            stats_.OnLengthClamp();
+        }
         frac_             = length - static_cast<float>(int_length);
-        length_ = static_cast<size_t>(int_length) < max_size ? int_length
-                                                           : max_size - 1;
+        length_ = static_cast<size_t>(int_length) < Capacity() ? int_length
+                                                             : Capacity() - 1;
+        length_ = length_ > 0 ? length_ : 1;
+        Extend();
+        head_.read_ptr %= length_;
     }
 
     /** returns the buffer length in samples as a float
@@ -69,24 +440,117 @@ class LoopBuffer
         return l;
     }
 
+    /** returns the whole number of samples the reads wrap at
+    */
+    inline size_t GetLoopLength() const { return length_; }
+
     /** sets the read pointer position in samples
      *  If a float is passed, a fractional component will be ignored
      *  If the position is outside the bounds of the loop, the position is bounded between 0 and the length of the loop
     */
     inline void SetReadPosition(size_t position)
     {
-        read_ptr_ = position >= length_ ? position : length_ - 1;  //read_ptr_ must be bounded on the loop
-        read_ptr_ = read_ptr_ < 0 ? 0 : read_ptr_;                         //read_ptr_ must be bounded on the loop
+        SetReadPosition(head_, position);
+    }
+
+    /** sets the read pointer position of an additional playhead, bounded like SetReadPosition(size_t)
+    */
+    inline void SetReadPosition(LoopHead& h, size_t position)
+    {
+        h.read_ptr = position < length_ ? position : length_ - 1;  //read_ptr must be bounded on the loop
     }
 
     /** returns the position of the read pointer
     */
     inline size_t GetReadPosition()
     {
-        size_t rp = read_ptr_;
+        size_t rp = head_.read_ptr;
         return rp;
     }
 
+    /** copies n stored samples starting at position into out, converted to T, without moving any pointer.
+     *  position + n must not exceed the capacity.
+    */
+    inline void Peek(size_t position, T* out, size_t n) const { FormatPolicy::LoadBlock(store_.line, position, out, n); }
+
+    /** writes n samples starting at position without moving any pointer or changing the length.
+     *  position + n must not exceed the capacity.
+    */
+    inline void Poke(size_t position, const T* in, size_t n) { FormatPolicy::StoreBlock(store_.line, position, in, n); }
+
+    /** mixes the n samples starting at position into out, scaled by gain, and when in is not NULL overdubs it
+     *  into the same samples in the same pass: loop = loop * feedback + in * inputGain. No pointer moves.
+     *  position + n must not exceed the capacity. Used by LoopBank to play and overdub a span in one load.
+    */
+    inline void MixSpan(size_t position, T* out, size_t n, float gain, const T* in, float feedback, float inputGain)
+    {
+        T tmp[kKernelChunk];
+        while (n > 0) {
+            size_t k = KernelChunk(n);
+            T*     x = KernelSpan(position, tmp, k);
+            if (in != NULL) {
+                LoopKernelMixDub(x, in, out, k, gain, feedback, inputGain);
+                KernelCommit(position, x, k);
+                in += k;
+            } else {
+                LoopKernelMix(out, x, k, gain);
+            }
+            position += k;
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** audio side: starts and ends the timing of one block of work on this buffer, for the StatsPolicy.
+     *  Call around everything the callback does with the buffer. Nothing with LoopStatsNone.
+    */
+    inline void BeginBlock() { stats_.OnBlockBegin(); }
+    inline void EndBlock() { stats_.OnBlockEnd(); }
+
+    /** main loop side: copies the counters of the StatsPolicy into stats, lock-free.
+     *  Returns false, with stats zeroed, when the buffer is built without instrumentation.
+    */
+    inline bool GetStats(LoopStats& stats) const { return stats_.Get(stats); }
+
+    /** main loop side: zeroes the counters, applied at the next BeginBlock() */
+    inline void ClearStats() { stats_.Clear(); }
+
+    /** returns the length and positions of the buffer and its own playhead
+    */
+    LoopBufferState GetState() const
+    {
+        LoopBufferState s;
+        s.length      = length_;
+        s.length_frac = frac_;
+        s.write_ptr   = write_ptr_;
+        s.read_ptr    = head_.read_ptr;
+        s.read_frac   = head_.frac;
+        s.phase       = head_.phase;
+        s.increment   = head_.increment;
+        return s;
+    }
+
+    /** restores a state saved by GetState(), clamped to the capacity, without touching the samples.
+     *  The first length samples are taken as recorded, so they should be restored with Poke().
+    */
+    void SetState(const LoopBufferState& s)
+    {
+        length_    = s.length < 1 ? 1 : (s.length < Capacity() ? s.length : Capacity());
+        frac_      = s.length_frac;
+        write_ptr_ = s.write_ptr < Capacity() ? s.write_ptr : 0;
+        head_.Reset();
+        head_.read_ptr  = s.read_ptr < length_ ? s.read_ptr : 0;
+        head_.frac      = s.read_frac;
+        head_.phase     = s.phase;
+        head_.increment = s.increment;
+        splice_.active  = false;
+        valid_          = valid_ > length_ ? valid_ : length_;
+    }
+
+    /** returns the buffer's own playhead
+    */
+    inline LoopHead& GetHead() { return head_; }
+
     /** returns the position of the write pointer
     */
     inline size_t GetWritePosition()
@@ -99,69 +563,229 @@ class LoopBuffer
     */
     inline void Write(const T sample)
     {
-        line_[write_ptr_] = sample;
-        write_ptr_        = (write_ptr_ + 1) % max_size;
+        Store(write_ptr_, sample);
+        write_ptr_        = WrapPolicy::WrapBuffer(write_ptr_ + 1, Capacity());
+        stats_.OnWriteWrap(write_ptr_ == 0);
         if (write_ptr_ >= length_) { 
             length_ = write_ptr_ + 1;
+            Extend();
         }
     }
 
+    /** The reads below use the buffer's own playhead. Each has an overload taking a LoopHead&
+     *  as its first argument that reads from that head instead.
+    */
+    inline const T Read() { return Read(head_); }
+    inline const T ReadOnce() { return ReadOnce(head_); }
+    inline const T Read(float clipEnd, size_t minClip) { return Read(head_, clipEnd, minClip); }
+    inline const T Read(float clipStart, float clipEnd, size_t minClip)
+    {
+        return Read(head_, clipStart, clipEnd, minClip);
+    }
+    inline const T Read(float clipStart, float clipEnd, size_t minClip, bool randomLength, bool randomStart)
+    {
+        return Read(head_, clipStart, clipEnd, minClip, randomLength, randomStart);
+    }
+    inline const T Read(float clipStart, float clipEnd, float speed, size_t minClip, bool randomLength, bool randomStart)
+    {
+        return Read(head_, clipStart, clipEnd, speed, minClip, randomLength, randomStart);
+    }
+    inline void    SetClip(float start, float end, size_t minClip) { SetClip(head_, start, end, minClip); }
+    inline void    SetClipSmoothing(float smooth) { SetClipSmoothing(head_, smooth); }
+    inline void    UpdateClip() { UpdateClip(head_); }
+    inline const T ReadClip() { return ReadClip(head_); }
+    inline void    ReadClipBlock(T* out, size_t n) { ReadClipBlock(head_, out, n); }
+    inline const T ReadSpeed(float speed) { return ReadSpeed(head_, speed); }
+    inline const T ReadReverse() { return ReadReverse(head_); }
+    inline const T ReadPingPong() { return ReadPingPong(head_); }
+    inline void    ReadReverseBlock(T* out, size_t n) { ReadReverseBlock(head_, out, n); }
+    inline void    ReadPingPongBlock(T* out, size_t n) { ReadPingPongBlock(head_, out, n); }
+    inline void    ReadBlock(T* out, size_t n) { ReadBlock(head_, out, n); }
+    inline void    ReadOnceBlock(T* out, size_t n) { ReadOnceBlock(head_, out, n); }
+    inline void    ReadBlock(T* out, size_t n, float clipEnd, size_t minClip)
+    {
+        ReadBlock(head_, out, n, clipEnd, minClip);
+    }
+    inline void ReadBlock(T* out, size_t n, float clipStart, float clipEnd, size_t minClip)
+    {
+        ReadBlock(head_, out, n, clipStart, clipEnd, minClip);
+    }
+    inline void ReadBlock(T* out, size_t n, float clipStart, float clipEnd, size_t minClip, bool randomLength, bool randomStart)
+    {
+        ReadBlock(head_, out, n, clipStart, clipEnd, minClip, randomLength, randomStart);
+    }
+    inline void ReadSpeedBlock(T* out, size_t n, float speed) { ReadSpeedBlock(head_, out, n, speed); }
+    inline void SetPhaseSpeed(float speed) { SetPhaseSpeed(head_, speed); }
+    inline const T ReadPhase() { return ReadPhase(head_); }
+    inline void ReadPhaseBlock(T* out, size_t n) { ReadPhaseBlock(head_, out, n); }
+    inline void ReadBlock(T* out, size_t n, float clipStart, float clipEnd, float speed, size_t minClip, bool randomLength, bool randomStart)
+    {
+        ReadBlock(head_, out, n, clipStart, clipEnd, speed, minClip, randomLength, randomStart);
+    }
+
     /** returns the next sample of type T in the buffer, interpolated if necessary, and increments position of read pointer.
     */
-    inline const T Read() //const
+    inline const T Read(LoopHead& h) //const
     {
-        T a = line_[(read_ptr_) % length_];
-        //T b = line_[(read_ptr_ + 1) % length_];
-        read_ptr_ = (read_ptr_ + 1) % length_;
-        //return a + (b - a) * frac_;
+        //an additional head may still point past a loop that was shortened
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : 0;
+        T a = Load(h.read_ptr);
+        //T b = line_[(h.read_ptr + 1) % length_];
+        h.read_ptr = WrapPolicy::Wrap(h.read_ptr + 1, length_);
+        stats_.OnReadWrap(h.read_ptr == 0);
+        //return a + (b - a) * h.frac;
         return a;
     }
 
     /** returns the next sample of type T in the buffer, interpolated if necessary, and increments position of read pointer .
      *  but does not loop back once complete
     */
-    inline const T ReadOnce() //const
+    inline const T ReadOnce(LoopHead& h) //const
     {
         T a = 0;
 
-        if (read_ptr_ < length_) {
-            a = line_[(read_ptr_) % length_];
+        if (h.read_ptr < length_) {
+            a = Load(h.read_ptr);
         }
-        read_ptr_ = read_ptr_ < (length_ - 1) ? read_ptr_ + 1 : read_ptr_;
+        h.read_ptr = h.read_ptr < (length_ - 1) ? h.read_ptr + 1 : h.read_ptr;
 
         return a;
     }
 
+    /** returns the sample at the read pointer and moves the read pointer one sample back,
+     *  wrapping from the start of the loop to its end.
+    */
+    inline const T ReadReverse(LoopHead& h)
+    {
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : length_ - 1;
+        T a        = Load(h.read_ptr);
+        h.read_ptr = h.read_ptr > 0 ? h.read_ptr - 1 : length_ - 1;
+        return a;
+    }
+
+    /** returns the sample at the read pointer and moves it one sample in the head's direction,
+     *  turning around at both ends of the loop without repeating the end samples.
+    */
+    inline const T ReadPingPong(LoopHead& h)
+    {
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : length_ - 1;
+        T a        = Load(h.read_ptr);
+        if (!h.reverse) {
+            if (h.read_ptr + 1 < length_) {
+                h.read_ptr++;
+            } else if (length_ > 1) {
+                h.reverse = true;
+                h.read_ptr--;
+            }
+        } else {
+            if (h.read_ptr > 0) {
+                h.read_ptr--;
+            } else {
+                h.reverse  = false;
+                h.read_ptr = length_ > 1 ? 1 : 0;
+            }
+        }
+        return a;
+    }
+
     /** returns the next sample of type T in the buffer, with a defined clip length
     */
-    inline const T Read(float clipEnd, size_t minClip) //const
+    inline const T Read(LoopHead& h, float clipEnd, size_t minClip) //const
     {
         size_t newEnd = (size_t) (clipEnd * length_);
         newEnd = newEnd < minClip ? minClip : newEnd;
+        newEnd = newEnd >= length_ ? length_ : newEnd;
+        //a clip that shrank under the read pointer restarts
+        h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
 
         //limit the length of the clip as specified by clipEnd
-        T a = line_[(read_ptr_) % newEnd];
-        read_ptr_ = (read_ptr_ + 1) % newEnd;
+        T a = Load(h.read_ptr);
+        h.read_ptr = WrapPolicy::Wrap(h.read_ptr + 1, newEnd);
+        stats_.OnReadWrap(h.read_ptr == 0);
         
         return a;
     }
 
     /** returns the next sample of type T in the buffer, with a defined start point in the clip and a defined length
     */
-    inline const T Read(float clipStart, float clipEnd, size_t minClip) //const
+    inline const T Read(LoopHead& h, float clipStart, float clipEnd, size_t minClip) //const
     {
         size_t newEnd = (size_t) (clipEnd * length_);
         newEnd = newEnd < minClip ? minClip : newEnd;
+        newEnd = newEnd >= length_ ? length_ : newEnd;
         size_t offset = (size_t) (clipStart * length_);
+        h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
 
         //read the clip from the point specified by clipStart
-        T a = line_[(read_ptr_ + offset) % length_];
+        T a = Load(WrapPolicy::Wrap(h.read_ptr + offset, length_));
         //limit the length of the clip as specified by clipEnd
-        read_ptr_ = (read_ptr_ + 1) % newEnd;
+        h.read_ptr = WrapPolicy::Wrap(h.read_ptr + 1, newEnd);
+        stats_.OnReadWrap(h.read_ptr == 0);
         
         return a;
     }
 
+    /** sets the clip window read by ReadClip() and ReadClipBlock(), the same window as
+     *  Read(clipStart, clipEnd, minClip) but converted to samples once instead of on every read.
+     *  float start - [0..1.0] where in the loop the clip starts
+     *  float end   - [0..1.0] how long the clip is, as a fraction of the loop
+     *  size_t minClip - size in samples of the shortest allowable clip
+     *  With smoothing set by SetClipSmoothing(), the window glides to the new values over the next
+     *  UpdateClip() calls, otherwise it jumps there.
+    */
+    inline void SetClip(LoopHead& h, float start, float end, size_t minClip)
+    {
+        LoopClip& c = h.clip;
+        c.start     = start;
+        c.end       = end;
+        c.min       = minClip;
+        if (c.smooth >= 1.f) {
+            c.start_now = start;
+            c.end_now   = end;
+        }
+        c.length = 0;
+    }
+
+    /** sets how quickly the clip window follows SetClip(), as the fraction (0..1.0] of the remaining
+     *  distance covered by each UpdateClip(). For a time constant of tau seconds at block rate fb,
+     *  smooth = 1 - exp(-1 / (tau * fb)). 1, or a value outside the range, disables the smoothing.
+    */
+    inline void SetClipSmoothing(LoopHead& h, float smooth)
+    {
+        h.clip.smooth = smooth > 0.f && smooth < 1.f ? smooth : 1.f;
+    }
+
+    /** moves the clip window one control period closer to its target and converts it to samples if it
+     *  moved. ReadClipBlock() calls it once per block, call it once per block when using ReadClip().
+    */
+    inline void UpdateClip(LoopHead& h)
+    {
+        LoopClip& c = h.clip;
+        if (c.start_now != c.start || c.end_now != c.end) {
+            c.start_now = Glide(c.start_now, c.start, c.smooth);
+            c.end_now   = Glide(c.end_now, c.end, c.smooth);
+            c.length    = 0;
+        }
+        if (c.length != length_) {
+            ResolveClip(h);
+        }
+    }
+
+    /** returns the next sample of the clip set by SetClip(), and advances the head.
+     *  Only an increment and a wrap per sample, the window is converted when it or the loop length changes.
+    */
+    inline const T ReadClip(LoopHead& h) //const
+    {
+        if (h.clip.length != length_) {
+            ResolveClip(h);
+        }
+        T a = Load(WrapPolicy::Wrap(h.read_ptr + h.clip.offset, length_));
+        //a head moved past the end of the clip restarts it
+        h.read_ptr = h.read_ptr + 1 < h.clip.samples ? h.read_ptr + 1 : 0;
+        stats_.OnReadWrap(h.read_ptr == 0);
+        return a;
+    }
+
      /** returns the next sample of type T in the buffer, with a defined start point in the clip and a defined length as well as
       * the ability to randomize the start point and length
       * float clipStart -   [0..1.0] Specifies where in the loop the clip will start.  If randomStart is true, this knob affects how
@@ -169,21 +793,24 @@ class LoopBuffer
       * float clipEnd   -   [0..1.0] Specifies how long the clip is.  If randomLength is true, sets the range of possible lengths.
       * size_T minClip  -   Size in samples of the shortest allowable clip.
     */
-    inline const T Read(float clipStart, float clipEnd, size_t minClip, bool randomLength, bool randomStart) //const
+    inline const T Read(LoopHead& h, float clipStart, float clipEnd, size_t minClip, bool randomLength, bool randomStart) //const
     {
-        static size_t newEnd;
-        static size_t offset;
+        size_t &newEnd = h.clip_end;
+        size_t &offset = h.clip_offset;
         T a;
+        if ((randomStart || randomLength) && h.read_ptr == 0) {
+            stats_.OnRandomClip();
+        }
 
         if (!randomStart) {
             //select where in the clip is our starting point based on the knob position
             offset = (size_t) (clipStart * length_);
         } else {
-            if (GetReadPosition() == 0) {
+            if (h.read_ptr == 0) {
                 //At the start of each clip loop
                 //generate a random number between 0 and length_-1 and then mult by clipStart
                 //the higher clipStart is, the more random the starting point is from 0
-                offset = (size_t) (clipStart * (rand() % length_));
+                offset = (size_t) (clipStart * h.rng.Below(static_cast<uint32_t>(length_)));
             }
         }
 
@@ -193,18 +820,21 @@ class LoopBuffer
             //At the start of each clip loop
             //generate a random number between 0 and length_-1 and then mult by clipEnd
             //the higher clipEnd is, the more random the clip length will stray from half of the clip length
-            if (GetReadPosition() == 0) {
-                newEnd = (size_t) (clipEnd * (rand() % length_));
+            if (h.read_ptr == 0) {
+                newEnd = (size_t) (clipEnd * h.rng.Below(static_cast<uint32_t>(length_)));
             }
         }
         //boundary check
         newEnd = newEnd < minClip ? minClip : newEnd;
         newEnd = newEnd >= length_ ? length_ : newEnd;
+        offset = offset < length_ ? offset : offset % length_;    //a random start can outlive a shortened loop
+        h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
 
         //read the clip from the point specified by clipStart
-        a = line_[(read_ptr_ + offset) % length_];
+        a = Load(WrapPolicy::Wrap(h.read_ptr + offset, length_));
         //limit the length of the clip as specified by clipEnd
-        read_ptr_ = (read_ptr_ + 1) % newEnd;
+        h.read_ptr = WrapPolicy::Wrap(h.read_ptr + 1, newEnd);
+        stats_.OnReadWrap(h.read_ptr == 0);
         
         
         return a;
@@ -218,24 +848,24 @@ class LoopBuffer
       * float speed     -   [-2.0..2.0] The speed at which the clips plays back
       * size_T minClip  -   Size in samples of the shortest allowable clip.
     */
-    inline const T Read(float clipStart, float clipEnd, float speed, size_t minClip, bool randomLength, bool randomStart) //const
+    inline const T Read(LoopHead& h, float clipStart, float clipEnd, float speed, size_t minClip, bool randomLength, bool randomStart) //const
     {
-        static size_t newEnd;
-        static size_t offset;
-        size_t rpo;
-        T a, b;
-        float intpart;
+        size_t &newEnd = h.clip_end;
+        size_t &offset = h.clip_offset;
+        size_t idx;
         if (length_ > 1) {
+            if ((randomStart || randomLength) && h.read_ptr == 0) {
+                stats_.OnRandomClip();
+            }
             if (!randomStart) {
                 //select where in the clip is our starting point based on the knob position
                 offset = (size_t) (clipStart * length_);
             } else {
-                if (GetReadPosition() == 0) {
+                if (h.read_ptr == 0) {
                     //At the start of each clip loop
                     //generate a random number between 0 and length_-1 and then mult by clipStart
                     //the higher clipStart is, the more random the starting point is from 0
-                    offset = (size_t) (clipStart * (rand() % length_));
-                    if (offset < 10) { offset = 10; }   //hack to get rid of clicks
+                    offset = (size_t) (clipStart * h.rng.Below(static_cast<uint32_t>(length_)));
                 }
             }
 
@@ -245,28 +875,45 @@ class LoopBuffer
                 //At the start of each clip loop
                 //generate a random number between 0 and length_-1 and then mult by clipEnd
                 //the higher clipEnd is, the more random the clip length will stray from half of the clip length
-                if (GetReadPosition() == 0) {
-                    newEnd = (size_t) (clipEnd * (rand() % length_));
+                if (h.read_ptr == 0) {
+                    newEnd = (size_t) (clipEnd * h.rng.Below(static_cast<uint32_t>(length_)));
                 }
             }
             //boundary check
             newEnd = newEnd < minClip ? minClip : newEnd;
             newEnd = newEnd >= length_ ? length_ : newEnd;
+            offset = offset < length_ ? offset : offset % length_;    //a random start can outlive a shortened loop
+            h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
 
             //read the clip from the point specified by clipStart
-            rpo = read_ptr_ + offset;
-            a = line_[(rpo) % length_];
-            if (speed >= 0.f) {
-                b = line_[(rpo + 1) % length_];
-            } else {
-                b = (rpo - 1) > 0 ? line_[(rpo - 1) % length_] : length_ - 1;
-            }
+            idx = WrapPolicy::Wrap(h.read_ptr + offset, length_);
 
-            frac_ = modf((speed + frac_), &intpart);
-            read_ptr_ = (read_ptr_ + (int32_t)(intpart)) % newEnd;
-            if (read_ptr_ < 0) { read_ptr_ = newEnd - 1; }
-            
-            return a + (b - a) * frac_;
+            //truncate like modf() did, without the libm call
+            float   s    = speed + h.frac;
+            int32_t step = static_cast<int32_t>(s);
+            h.frac = s - step;
+            h.read_ptr = Advance(h.read_ptr, step, newEnd);
+
+            T a = InterpolateSigned(idx, h.frac);
+            if (h.fade_len > 0) {
+                if (idx != h.fade_next && h.fade_next < length_) {
+                    //the clip wrapped or moved: keep playing where the read would have gone, and fade it out.
+                    //A jump early in a fade keeps the old tail, which is still the louder of the two
+                    if (2 * h.fade_pos >= h.fade_len) {
+                        h.fade_tail = h.fade_next;
+                    }
+                    h.fade_pos = 0;
+                }
+                if (h.fade_pos < h.fade_len) {
+                    float in, out;
+                    LoopFade::Gains(h.fade_pos * h.fade_step, in, out);
+                    a = a * in + InterpolateSigned(h.fade_tail, h.frac) * out;
+                    h.fade_tail = Advance(h.fade_tail, step, length_);
+                    h.fade_pos++;
+                }
+                h.fade_next = Advance(idx, step, length_);
+            }
+            return a;
         } else {
             return 0.f;
         }
@@ -276,66 +923,785 @@ class LoopBuffer
     /** returns the next sample of type T in the buffer, interpolated if necessary, and increments position of read pointer
         at a variable read speed.
     */
-    inline const T ReadSpeed(float speed) //const
+    inline const T ReadSpeed(LoopHead& h, float speed) //const
     {
-        read_ptr_ = (read_ptr_ + (int)floor(speed + frac_)) % length_;
-        if (read_ptr_ < 0) { read_ptr_ = length_ - 1; }     //SE20211103: this accounts for negative speeds
-        frac_ = speed + frac_ - static_cast<int32_t>(speed + frac_);
-        T a = line_[(read_ptr_) % length_];
-        T b = line_[(read_ptr_ + 1) % length_];
-        /*if (speed >= 0) {
-            b = line_[(read_ptr_ + 1) % length_];
-        } else {
-            b = line_[(read_ptr_ + 1) % length_];
-        }*/
-        
-        return a + (b - a) * frac_;
+        float   s    = speed + h.frac;
+        int32_t step = static_cast<int32_t>(s);
+        step -= (s < static_cast<float>(step));    //floor without a libm call
+        h.read_ptr = Advance(h.read_ptr, step, length_);     //wraps negative speeds back onto the end of the loop
+        h.frac = s - step;
+
+        return Interpolate(h.read_ptr, h.frac);
     }
 
-    /** forces a smooth transition between the start and end of a loop
+    /** sets the speed used by ReadPhase() as a 32.32 fixed-point increment.
+     *  Call at control rate, the conversion from float happens only here.
     */
-    inline void Splice()
+    inline void SetPhaseSpeed(LoopHead& h, float speed)
     {
-        //TODO: Check if loop is longer than fadeLength
-        int fadeLength = 2048;
-        /*for (int i = 0; i < fadeLength; i++) {
-            line_[((int)length_ - fadeLength + i)] = ((i/fadeLength)*(i/fadeLength) * line_[fadeLength - (i+1)]) + ((1 - (i/fadeLength)*(i/fadeLength)) * line_[((int)length_ - fadeLength + i)]);
-        }*/
-        //first order lowpass to smooth transition
-        //T prev = line_[length_ - 1 - fadeLength];
-        //T coef = 0.0000571;                       //25Hz
-        //for (int j = 0; j < 8; j++) {
+        h.increment = static_cast<int64_t>(speed * 4294967296.0);
+    }
+
+    /** returns the next sample at the speed set by SetPhaseSpeed(), advancing a fixed-point phase accumulator.
+     *  The index and fraction come from shifts and masks, so pitch stays exact over long loops and there is
+     *  no floor or float-to-int conversion per sample.
+    */
+    inline const T ReadPhase(LoopHead& h) //const
+    {
+        int64_t acc = static_cast<int64_t>(h.phase) + h.increment;
+        h.phase     = static_cast<uint32_t>(acc);
+        h.read_ptr  = Advance(h.read_ptr, static_cast<int32_t>(acc >> 32), length_);
+        h.frac      = PhaseToFrac(h.phase);
+
+        return Interpolate(h.read_ptr, h.frac);
+    }
 
-            for (int i = 0; i < fadeLength; i++) {
-                line_[i]                 *= (float)i / (float)fadeLength;
-                line_[(length_ - 1) - i] *= (float)i / (float)fadeLength;
+    /** writes n samples of type T to the delay line, equivalent to n calls to Write().
+     *  The copy is split at the end of the buffer into at most two contiguous spans.
+    */
+    inline void WriteBlock(const T* in, size_t n)
+    {
+        while (n > 0) {
+            size_t k = Capacity() - write_ptr_;
+            k = k < n ? k : n;
+            FormatPolicy::StoreBlock(store_.line, write_ptr_, in, k);
+            valid_ = valid_ > write_ptr_ + k ? valid_ : write_ptr_ + k;
+            //Write() extends length_ to one past the furthest write pointer it has seen
+            size_t hi = write_ptr_ + k < Capacity() ? write_ptr_ + k : Capacity() - 1;
+            if (hi > write_ptr_ && hi >= length_) {
+                length_ = hi + 1;
+                Extend();
+            }
+            write_ptr_ = WrapPolicy::WrapBuffer(write_ptr_ + k, Capacity());
+            stats_.OnWriteWrap(write_ptr_ == 0);
+            in += k;
+            n -= k;
+        }
+    }
+
+    /** mixes one sample into the loop at the write pointer: loop = loop * feedback + sample * inputGain.
+     *  Overdubbing plays over the recorded loop, so the write pointer wraps at the loop length and the length is kept.
+    */
+    inline void Overdub(const T sample, float feedback, float inputGain)
+    {
+        write_ptr_ = write_ptr_ < length_ ? write_ptr_ : 0;
+        Store(write_ptr_, Load(write_ptr_) * feedback + sample * inputGain);
+        write_ptr_ = WrapPolicy::Wrap(write_ptr_ + 1, length_);
+    }
+
+    /** mixes n samples into the loop with a fixed feedback, equivalent to n calls to Overdub(sample, feedback, inputGain).
+     *  Each sample is read and written once, in contiguous spans between the loop wraps.
+    */
+    inline void Overdub(const T* in, size_t n, float feedback, float inputGain)
+    {
+        OverdubSpans(in, NULL, n, feedback, 0.f, inputGain);
+    }
+
+    /** mixes n samples into the loop with the feedback ramping linearly from feedbackStart towards feedbackEnd,
+     *  reaching it on the sample after the block, so consecutive blocks join without zipper noise.
+    */
+    inline void Overdub(const T* in, size_t n, float feedbackStart, float feedbackEnd, float inputGain)
+    {
+        float step = n > 0 ? (feedbackEnd - feedbackStart) / static_cast<float>(n) : 0.f;
+        OverdubSpans(in, NULL, n, feedbackStart, step, inputGain);
+    }
+
+    /** mixes n samples into the loop with a per-sample feedback gain
+    */
+    inline void Overdub(const T* in, const float* feedback, size_t n, float inputGain)
+    {
+        OverdubSpans(in, feedback, n, 0.f, 0.f, inputGain);
+    }
+
+    /** reads n samples into out, equivalent to n calls to Read().
+    */
+    inline void ReadBlock(LoopHead& h, T* out, size_t n)
+    {
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : 0;
+        while (n > 0) {
+            size_t k = length_ - h.read_ptr;
+            k = k < n ? k : n;
+            FormatPolicy::LoadBlock(store_.line, h.read_ptr, out, k);
+            h.read_ptr = h.read_ptr + k < length_ ? h.read_ptr + k : 0;
+            stats_.OnReadWrap(h.read_ptr == 0);
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to ReadOnce().
+     *  Once the end of the loop is reached the last sample is held.
+    */
+    inline void ReadOnceBlock(LoopHead& h, T* out, size_t n)
+    {
+        size_t i = 0;
+        if (h.read_ptr < length_) {
+            //copy up to the last sample, then hold it
+            size_t k = (length_ - 1) - h.read_ptr;
+            k = k < n ? k : n;
+            FormatPolicy::LoadBlock(store_.line, h.read_ptr, out, k);
+            i = k;
+            h.read_ptr += k;
+        }
+        T hold = h.read_ptr < length_ ? Load(h.read_ptr) : T(0);
+        for (; i < n; i++) {
+            out[i] = hold;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to ReadReverse().
+     *  Copies contiguous spans and reverses them, split only where the read passes the start of the loop.
+    */
+    inline void ReadReverseBlock(LoopHead& h, T* out, size_t n)
+    {
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : length_ - 1;
+        while (n > 0) {
+            size_t k = h.read_ptr + 1;
+            k = k < n ? k : n;
+            LoadReversed(h.read_ptr, out, k);
+            h.read_ptr = h.read_ptr >= k ? h.read_ptr - k : length_ - 1;
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to ReadPingPong().
+     *  Copies contiguous spans forwards or reversed, split only where the read turns around.
+    */
+    inline void ReadPingPongBlock(LoopHead& h, T* out, size_t n)
+    {
+        h.read_ptr = h.read_ptr < length_ ? h.read_ptr : length_ - 1;
+        while (n > 0) {
+            size_t k;
+            if (!h.reverse) {
+                k = length_ - h.read_ptr;
+                k = k < n ? k : n;
+                FormatPolicy::LoadBlock(store_.line, h.read_ptr, out, k);
+                h.read_ptr += k;
+                if (h.read_ptr == length_) {
+                    h.reverse  = length_ > 1;
+                    h.read_ptr = length_ > 1 ? length_ - 2 : 0;
+                }
+            } else {
+                k = h.read_ptr + 1;
+                k = k < n ? k : n;
+                LoadReversed(h.read_ptr, out, k);
+                if (k > h.read_ptr) {
+                    h.reverse  = false;
+                    h.read_ptr = length_ > 1 ? 1 : 0;
+                } else {
+                    h.read_ptr -= k;
+                }
+            }
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to Read(clipEnd, minClip).
+    */
+    inline void ReadBlock(LoopHead& h, T* out, size_t n, float clipEnd, size_t minClip)
+    {
+        size_t newEnd = (size_t) (clipEnd * length_);
+        newEnd = newEnd < minClip ? minClip : newEnd;
+        newEnd = newEnd >= length_ ? length_ : newEnd;
+
+        h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
+        while (n > 0) {
+            size_t k = newEnd - h.read_ptr;
+            k = k < n ? k : n;
+            FormatPolicy::LoadBlock(store_.line, h.read_ptr, out, k);
+            h.read_ptr = h.read_ptr + k < newEnd ? h.read_ptr + k : 0;
+            stats_.OnReadWrap(h.read_ptr == 0);
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to Read(clipStart, clipEnd, minClip).
+    */
+    inline void ReadBlock(LoopHead& h, T* out, size_t n, float clipStart, float clipEnd, size_t minClip)
+    {
+        size_t newEnd = (size_t) (clipEnd * length_);
+        newEnd = newEnd < minClip ? minClip : newEnd;
+        newEnd = newEnd >= length_ ? length_ : newEnd;
+        size_t offset = (size_t) (clipStart * length_);
+
+        h.read_ptr = h.read_ptr < newEnd ? h.read_ptr : 0;
+        ReadClipSpans(h, out, n, offset, newEnd);
+    }
+
+    /** reads n samples of the clip set by SetClip() into out, after one UpdateClip(). Equivalent to
+     *  UpdateClip() followed by n calls to ReadClip().
+    */
+    inline void ReadClipBlock(LoopHead& h, T* out, size_t n)
+    {
+        UpdateClip(h);
+        h.read_ptr = h.read_ptr < h.clip.samples ? h.read_ptr : 0;
+        ReadClipSpans(h, out, n, h.clip.offset, h.clip.samples);
+    }
+
+    /** reads n samples into out, equivalent to n calls to Read(clipStart, clipEnd, minClip, randomLength, randomStart).
+     *  A new random clip is only drawn where the clip wraps, so the spans in between are plain copies.
+    */
+    inline void ReadBlock(LoopHead& h, T* out, size_t n, float clipStart, float clipEnd, size_t minClip, bool randomLength, bool randomStart)
+    {
+        while (n > 0) {
+            if ((randomStart || randomLength) && h.read_ptr == 0) {
+                //clip boundary, let the per-sample path draw the new clip
+                *out++ = Read(h, clipStart, clipEnd, minClip, randomLength, randomStart);
+                n--;
+                continue;
+            }
+            if (!randomStart) {
+                h.clip_offset = (size_t) (clipStart * length_);
+            }
+            if (!randomLength) {
+                h.clip_end = (size_t) (clipEnd * length_);
+            }
+            h.clip_end = h.clip_end < minClip ? minClip : h.clip_end;
+            h.clip_end = h.clip_end >= length_ ? length_ : h.clip_end;
+            h.clip_offset = h.clip_offset < length_ ? h.clip_offset : h.clip_offset % length_;
+
+            h.read_ptr = h.read_ptr < h.clip_end ? h.read_ptr : 0;
+            //render up to and including the sample that wraps the clip
+            size_t k = h.clip_end - h.read_ptr;
+            k = k < n ? k : n;
+            ReadClipSpans(h, out, k, h.clip_offset, h.clip_end);
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to ReadSpeed(speed).
+     *  Negative speeds walk the same contiguous spans backwards, so reverse voices cost the same as forward ones.
+     *  With LoopHead::SetSpeedRamp() a new speed is reached over the ramp instead, equivalent to n calls to
+     *  ReadSpeed(h.glide.Next()). The ramp runs in the same loop that fetches the samples and carries on
+     *  across blocks.
+    */
+    inline void ReadSpeedBlock(LoopHead& h, T* out, size_t n, float speed)
+    {
+        LoopRamp& r = h.glide;
+        r.Set(speed);
+        size_t i = 0;
+        while (i < n) {
+            //the speed moves by dv per sample until the last sample of the ramp, which Next() lands on the target
+            float  v     = r.value;
+            float  dv    = r.left > 0 ? r.step : 0.f;
+            size_t limit = r.left > 0 ? r.left - 1 : n - i;
+            //a ramp is monotonic, so its largest step is at one of its ends
+            bool  forward = v >= 0.f && r.target >= 0.f;
+            bool  back    = v < 0.f && r.target < 0.f;
+            float top     = forward ? (v > r.target ? v : r.target) : -(v < r.target ? v : r.target);
+            size_t maxStep = (size_t) top + 1;
+            //steps that keep every interpolation tap inside the loop
+            size_t k = 0;
+            if ((forward || back) && h.frac >= 0.f && h.read_ptr >= kTapsBefore && h.read_ptr + kTapsAfter < length_) {
+                k = forward ? ((length_ - 1 - kTapsAfter) - h.read_ptr) / maxStep
+                            : (h.read_ptr - kTapsBefore) / maxStep;
+                k = k < limit ? k : limit;
+                k = k < (n - i) ? k : (n - i);
+            }
+            if (k == 0) {
+                //near the loop boundary, at the end of a ramp or turning around, fall back to the per-sample path
+                stats_.OnFallback();
+                out[i++] = ReadSpeed(h, r.Next());
+                continue;
+            }
+            //the position is kept in locals, stores to out could otherwise alias h.frac
+            size_t ptr  = h.read_ptr;
+            float  frac = h.frac;
+            if (forward) {
+                for (size_t j = 0; j < k; j++) {
+                    v += dv;
+                    float   s    = v + frac;
+                    int32_t step = static_cast<int32_t>(s);
+                    ptr += step;
+                    frac     = s - step;
+                    out[i++] = InterpolateSpan(ptr, frac);
+                }
+            } else {
+                //reversing: the step is never positive, and never passes the first taps
+                for (size_t j = 0; j < k; j++) {
+                    v += dv;
+                    float   s    = v + frac;
+                    int32_t step = static_cast<int32_t>(s);
+                    float   fl   = static_cast<float>(step);
+                    bool    down = s < fl;    //floor, kept in float so frac does not wait on a conversion
+                    fl -= down ? 1.f : 0.f;
+                    step -= down;
+                    ptr -= static_cast<size_t>(-step);
+                    frac     = s - fl;
+                    out[i++] = InterpolateSpan(ptr, frac);
+                }
+            }
+            h.read_ptr = ptr;
+            h.frac     = frac;
+            if (r.left > 0) {
+                r.value = v;
+                r.left -= k;
+            }
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to ReadPhase(), in either direction.
+    */
+    inline void ReadPhaseBlock(LoopHead& h, T* out, size_t n)
+    {
+        const int64_t inc     = h.increment;
+        size_t        maxStep = inc >= 0 ? static_cast<size_t>(inc >> 32) + 1 : static_cast<size_t>((-inc) >> 32) + 1;
+        size_t        i       = 0;
+        while (i < n) {
+            size_t k = 0;
+            if (h.read_ptr >= kTapsBefore && h.read_ptr + kTapsAfter < length_) {
+                k = inc >= 0 ? ((length_ - 1 - kTapsAfter) - h.read_ptr) / maxStep
+                             : (h.read_ptr - kTapsBefore) / maxStep;
+                k = k < (n - i) ? k : (n - i);
+            }
+            if (k == 0) {
+                stats_.OnFallback();
+                out[i++] = ReadPhase(h);
+                continue;
+            }
+            size_t   ptr   = h.read_ptr;
+            uint32_t phase = h.phase;
+            if (inc >= 0) {
+                for (size_t j = 0; j < k; j++) {
+                    uint64_t acc = static_cast<uint64_t>(phase) + static_cast<uint64_t>(inc);
+                    phase        = static_cast<uint32_t>(acc);
+                    ptr += static_cast<size_t>(acc >> 32);
+                    out[i++] = InterpolateSpan(ptr, PhaseToFrac(phase));
+                }
+            } else {
+                for (size_t j = 0; j < k; j++) {
+                    int64_t acc = static_cast<int64_t>(phase) + inc;
+                    phase       = static_cast<uint32_t>(acc);
+                    ptr -= static_cast<size_t>(-(acc >> 32));
+                    out[i++] = InterpolateSpan(ptr, PhaseToFrac(phase));
+                }
+            }
+            h.read_ptr = ptr;
+            h.phase    = phase;
+            h.frac     = PhaseToFrac(phase);
+        }
+    }
+
+    /** reads n samples into out, equivalent to n calls to Read(clipStart, clipEnd, speed, minClip, randomLength, randomStart).
+     *  With LoopHead::SetSpeedRamp() the speed glides to a new value like ReadSpeedBlock(), equivalent to
+     *  passing h.glide.Next() as the speed of each call.
+    */
+    inline void ReadBlock(LoopHead& h, T* out, size_t n, float clipStart, float clipEnd, float speed, size_t minClip, bool randomLength, bool randomStart)
+    {
+        LoopRamp& r = h.glide;
+        r.Set(speed);
+        size_t i = 0;
+        while (i < n) {
+            if (length_ <= 1) {
+                r.Next();
+                out[i++] = 0.f;
+                continue;
+            }
+            //the speed moves by dv per sample until the last sample of the ramp, which Next() lands on the target
+            float  v     = r.value;
+            float  dv    = r.left > 0 ? r.step : 0.f;
+            size_t limit = r.left > 0 ? r.left - 1 : n - i;
+            if (v < 0.f || r.target < 0.f || h.frac < 0.f || h.fade_pos < h.fade_len || ((randomStart || randomLength) && h.read_ptr == 0)) {
+                //reversing, crossfading or drawing a new clip, let the per-sample path handle it
+                stats_.OnFallback();
+                out[i++] = Read(h, clipStart, clipEnd, r.Next(), minClip, randomLength, randomStart);
+                continue;
+            }
+            //a ramp is monotonic, so its largest step is at one of its ends
+            size_t maxStep = (size_t) (v > r.target ? v : r.target) + 1;
+            if (!randomStart) {
+                h.clip_offset = (size_t) (clipStart * length_);
+            }
+            if (!randomLength) {
+                h.clip_end = (size_t) (clipEnd * length_);
+            }
+            h.clip_end = h.clip_end < minClip ? minClip : h.clip_end;
+            h.clip_end = h.clip_end >= length_ ? length_ : h.clip_end;
+            h.clip_offset = h.clip_offset < length_ ? h.clip_offset : h.clip_offset % length_;
+
+            //steps that neither wrap the clip nor move a tap past the end of the loop
+            size_t k = 0;
+            size_t idx = WrapPolicy::Wrap(h.read_ptr + h.clip_offset, length_);
+            bool   jumped = h.fade_len > 0 && idx != h.fade_next;    //starts a crossfade
+            if (!jumped && h.read_ptr < h.clip_end && idx >= kTapsBefore && idx + kTapsAfter < length_) {
+                size_t kc = ((h.clip_end - 1) - h.read_ptr) / maxStep;
+                size_t kl = ((length_ - 1 - kTapsAfter) - idx) / maxStep + 1;
+                k = kc < kl ? kc : kl;
+                k = k < limit ? k : limit;
+                k = k < (n - i) ? k : (n - i);
             }
-        //}
+            if (k == 0) {
+                stats_.OnFallback();
+                out[i++] = Read(h, clipStart, clipEnd, r.Next(), minClip, randomLength, randomStart);
+                continue;
+            }
+            for (size_t j = 0; j < k; j++) {
+                size_t  x    = idx;
+                v += dv;
+                float   s    = v + h.frac;
+                int32_t step = static_cast<int32_t>(s);
+                h.frac = s - step;
+                h.read_ptr += step;
+                idx += step;
+                out[i++] = InterpolateSpan(x, h.frac);
+            }
+            if (r.left > 0) {
+                r.value = v;
+                r.left -= k;
+            }
+            if (h.fade_len > 0) {
+                h.fade_next = idx < length_ ? idx : idx % length_;
+            }
+        }
+    }
+
+    static const size_t kSpliceFade = 2048; //fade length of Splice() and StartSplice() without a range
 
+    /** forces a smooth transition between the start and end of a loop by fading the recorded audio.
+     *  This rewrites the buffer, LoopHead::SetCrossfade() removes the click at read time instead.
+     *  Runs the whole splice at once, use StartSplice() and SpliceStep() to spread it over several callbacks.
+    */
+    inline void Splice()
+    {
+        Splice(kSpliceFade, 0, (int)length_ - 1);
     }
 
+    /** fades fadeLength samples in from startPoint and out towards endPoint, and clears the loop after endPoint.
+     *  Runs the whole splice at once, use StartSplice() and SpliceStep() to spread it over several callbacks.
+    */
     inline void Splice(int fadeLength, int startPoint, int endPoint)
     {
-        if ((2*fadeLength < (int)length_) && (startPoint >= 0) && (endPoint < (int)length_))
-        {
-            for (int i = 0; i < fadeLength; i++) {
-                line_[startPoint + i] *= (float)i / (float)fadeLength;
-                line_[endPoint - i]   *= (float)i / (float)fadeLength;
+        if (fadeLength < 0 || startPoint < 0 || endPoint < 0) {
+            return;
+        }
+        if (StartSplice(fadeLength, startPoint, endPoint)) {
+            SpliceStep(SIZE_MAX);
+        }
+    }
+
+    /** called by SpliceStep() once a splice is complete */
+    typedef void (*SpliceCallback)(void* context);
+
+    /** starts a splice of the whole loop like Splice(), the work is done by SpliceStep().
+     *  Returns false, and starts nothing, if the loop is too short for the fade.
+    */
+    bool StartSplice(SpliceCallback callback = NULL, void* context = NULL)
+    {
+        return length_ > 0 && StartSplice(kSpliceFade, 0, length_ - 1, callback, context);
+    }
+
+    /** starts a splice like Splice(fadeLength, startPoint, endPoint), the work is done by SpliceStep().
+     *  A splice that is still running is replaced. Returns false, and starts nothing, if the range does not fit the loop:
+     *  both fades must lie inside the loop and startPoint must not be after endPoint.
+     *  The splice works on the loop length at the time it is started.
+    */
+    bool StartSplice(size_t fadeLength, size_t startPoint, size_t endPoint, SpliceCallback callback = NULL, void* context = NULL)
+    {
+        if (2 * fadeLength >= length_ || endPoint >= length_ || endPoint + 1 < fadeLength || startPoint > endPoint
+            || fadeLength > length_ - startPoint) {
+            return false;
+        }
+        splice_.fade     = fadeLength;
+        splice_.start    = startPoint;
+        splice_.end      = endPoint;
+        splice_.zero_end = length_;
+        splice_.pos      = 0;
+        splice_.zero     = endPoint;
+        splice_.callback = callback;
+        splice_.context  = context;
+        splice_.active   = true;
+        return true;
+    }
+
+    /** advances a running splice by at most maxSamples written samples, call once per block with a fixed budget.
+     *  At least one fade step (two samples) is made per call. Returns the number of samples written,
+     *  the completion callback runs once the last one is written.
+    */
+    size_t SpliceStep(size_t maxSamples)
+    {
+        if (!splice_.active) {
+            return 0;
+        }
+        size_t done = 0;
+        //fade both ends, two samples per step. When the two fades overlap, the shared samples are
+        //faded one step at a time so the result does not depend on maxSamples
+        float scale   = 1.f / static_cast<float>(splice_.fade);
+        bool  overlap = splice_.start + splice_.fade > splice_.end + 1 - splice_.fade;
+        while (splice_.pos < splice_.fade && (done == 0 || done + 2 <= maxSamples)) {
+            size_t steps = splice_.fade - splice_.pos;
+            size_t limit = (maxSamples - done) / 2 > 0 ? (maxSamples - done) / 2 : 1;
+            steps        = overlap ? 1 : steps < limit ? steps : limit;
+            int32_t pos  = static_cast<int32_t>(splice_.pos);
+            int32_t top  = static_cast<int32_t>(splice_.pos + steps - 1);
+            FadeSpan(splice_.start + splice_.pos, steps, pos, 1, scale);
+            FadeSpan(splice_.end - (splice_.pos + steps - 1), steps, top, -1, scale);
+            splice_.pos += steps;
+            done += 2 * steps;
+        }
+        //then clear what follows the end point
+        if (splice_.pos == splice_.fade && done < maxSamples) {
+            size_t k = splice_.zero_end - splice_.zero;
+            k = k < maxSamples - done ? k : maxSamples - done;
+            memset(&store_.line[splice_.zero * kWords], 0, k * kWords * sizeof(Word));
+            splice_.zero += k;
+            done += k;
+        }
+        if (splice_.pos == splice_.fade && splice_.zero == splice_.zero_end) {
+            splice_.active = false;
+            if (splice_.callback != NULL) {
+                splice_.callback(splice_.context);
             }
-            //zero out remaing portion of the buffer
-            for (int i = endPoint; i < (int)length_; i++) {
-                line_[i] = 0.f;
-            }    
         }
-        
+        return done;
+    }
+
+    /** returns true while a splice started by StartSplice() still has samples to write */
+    inline bool IsSplicing() const { return splice_.active; }
+
+    /** returns how much of the running splice is done, [0..1.0], 1.0 when no splice is running */
+    inline float GetSpliceProgress() const
+    {
+        if (!splice_.active) {
+            return 1.f;
+        }
+        size_t total = 2 * splice_.fade + (splice_.zero_end - splice_.end);
+        size_t done  = 2 * splice_.pos + (splice_.zero - splice_.end);
+        return static_cast<float>(done) / static_cast<float>(total);
     }
 
   private:
-    float  frac_;
-    size_t write_ptr_;
-    size_t read_ptr_;
-    size_t length_;
-    T      line_[max_size];
+
+    static const size_t kTapsBefore = InterpPolicy::kBefore;
+    static const size_t kTapsAfter  = InterpPolicy::kAfter;
+    static const size_t kWords      = FormatPolicy::kWordsPerSample;
+    static const size_t kKernelChunk = 64;     //samples converted at a time by the kernels of loopkernels.h
+
+    /** state of the splice advanced by SpliceStep() */
+    struct SpliceJob
+    {
+        size_t         fade;
+        size_t         start;
+        size_t         end;
+        size_t         zero_end;
+        size_t         pos;    //next fade step
+        size_t         zero;   //next sample to clear
+        SpliceCallback callback;
+        void*          context;
+        bool           active;
+    };
+
+    inline T Load(size_t i) const { return FormatPolicy::Load(store_.line, i); }
+
+    inline void Store(size_t i, T x) { FormatPolicy::Store(store_.line, i, x); }
+
+    /** copies the k samples ending at position i into out, last one first */
+    inline void LoadReversed(size_t i, T* out, size_t k)
+    {
+        FormatPolicy::LoadBlock(store_.line, i + 1 - k, out, k);
+        LoopKernelReverse(out, k);
+    }
+
+    /** interpolates at idx where every tap is known to be inside the loop, reading the taps in place
+     *  when they are stored as T
+    */
+    inline const T InterpolateSpan(size_t idx, float frac)
+    {
+        T        scratch[kTapsBefore + kTapsAfter + 1];
+        const T* x = FormatPolicy::Taps(store_.line, idx - kTapsBefore, scratch, kTapsBefore + kTapsAfter + 1);
+        return InterpPolicy::Interpolate(x + kTapsBefore, frac);
+    }
+
+    /** gathers the interpolation taps around idx, wrapping at the loop length, and interpolates.
+     *  Used by the per-sample reads and by the block reads close to the loop boundary.
+    */
+    inline const T Interpolate(size_t idx, float frac)
+    {
+        T taps[kTapsBefore + kTapsAfter + 1];
+        for (size_t j = 0; j < kTapsBefore + kTapsAfter + 1; j++) {
+            taps[j] = Load(Advance(idx, static_cast<int32_t>(j) - static_cast<int32_t>(kTapsBefore), length_));
+        }
+        return InterpPolicy::Interpolate(taps + kTapsBefore, frac);
+    }
+
+    /** interpolates at idx + frac where frac may be negative, as left by reversing
+    */
+    inline const T InterpolateSigned(size_t idx, float frac)
+    {
+        if (frac >= 0.f) {
+            return Interpolate(idx, frac);
+        }
+        return Interpolate(idx > 0 ? idx - 1 : length_ - 1, 1.f + frac);
+    }
+
+    /** converts a 32 bit phase fraction to [0..1), using the top 24 bits so the result is exact in a float
+    */
+    static inline float PhaseToFrac(uint32_t phase)
+    {
+        return static_cast<float>(phase >> 8) * (1.f / 16777216.f);
+    }
+
+    /** clears the samples the loop just grew over that were never recorded, so that every
+     *  position below length_ holds audio or silence. Does nothing unless in lazy mode.
+    */
+    inline void Extend()
+    {
+        if (length_ > valid_) {
+            memset(&store_.line[valid_ * kWords], 0, (length_ - valid_) * kWords * sizeof(Word));
+            valid_ = length_;
+        }
+    }
+
+    /** returns how many of n samples a kernel may work on at once, all of them when the format stores T */
+    static inline size_t KernelChunk(size_t n)
+    {
+        return FormatPolicy::kInPlace || n < kKernelChunk ? n : kKernelChunk;
+    }
+
+    /** returns the k samples from position i for a kernel to modify, the buffer itself when the format
+     *  stores T, otherwise a copy converted into scratch
+    */
+    inline T* KernelSpan(size_t i, T* scratch, size_t k)
+    {
+        if (FormatPolicy::kInPlace) {
+            return reinterpret_cast<T*>(&store_.line[i]);
+        }
+        FormatPolicy::LoadBlock(store_.line, i, scratch, k);
+        return scratch;
+    }
+
+    /** stores a span returned by KernelSpan() back into the buffer */
+    inline void KernelCommit(size_t i, const T* x, size_t k)
+    {
+        if (!FormatPolicy::kInPlace) {
+            FormatPolicy::StoreBlock(store_.line, i, x, k);
+        }
+    }
+
+    /** multiplies the n samples from position i by the fade gains (first + dir * j) * scale */
+    inline void FadeSpan(size_t i, size_t n, int32_t first, int32_t dir, float scale)
+    {
+        T tmp[kKernelChunk];
+        while (n > 0) {
+            size_t k = KernelChunk(n);
+            T*     x = KernelSpan(i, tmp, k);
+            LoopKernelFade(x, k, first, dir, scale);
+            KernelCommit(i, x, k);
+            first += dir * static_cast<int32_t>(k);
+            i += k;
+            n -= k;
+        }
+    }
+
+    /** overdubs n samples at the write pointer, with the feedback taken from feedback[] or,
+     *  when it is NULL, ramped from fb by fbStep per sample. Works through the kernels of loopkernels.h,
+     *  kKernelChunk samples at a time.
+    */
+    inline void OverdubSpans(const T* in, const float* feedback, size_t n, float fb, float fbStep, float inputGain)
+    {
+        write_ptr_  = write_ptr_ < length_ ? write_ptr_ : 0;
+        size_t done = 0;
+        while (n > 0) {
+            size_t k = length_ - write_ptr_;
+            k = k < n ? k : n;
+            k = KernelChunk(k);
+            T  tmp[kKernelChunk];
+            T* x = KernelSpan(write_ptr_, tmp, k);
+            if (feedback != NULL) {
+                LoopKernelGainMix(x, feedback, in, k, inputGain);
+                feedback += k;
+            } else {
+                LoopKernelRampMix(x, in, k, fb, fbStep, inputGain, done);
+            }
+            KernelCommit(write_ptr_, x, k);
+            write_ptr_ = WrapPolicy::Wrap(write_ptr_ + k, length_);
+            in += k;
+            n -= k;
+            done += k;
+        }
+    }
+
+    /** returns the capacity in samples, a constant unless this is a LoopBufferView */
+    inline size_t Capacity() const { return store_.Samples(); }
+
+    /** points a LoopBufferView at caller-owned memory */
+    inline void Attach(void* memory, size_t samples)
+    {
+        static_assert(max_size == 0, "only a LoopBufferView (max_size 0) takes external memory");
+        if (WrapPolicy::kPowerOfTwo) {
+            //round down so that positions can still be masked
+            while (samples & (samples - 1)) {
+                samples &= samples - 1;
+            }
+        }
+        store_.line    = static_cast<Word*>(memory);
+        store_.samples = samples;
+    }
+
+    /** copies n samples of the clip [offset, offset + newEnd) into out, splitting only where
+     *  the clip or the loop wraps. h.read_ptr must already be inside the clip.
+    */
+    inline void ReadClipSpans(LoopHead& h, T* out, size_t n, size_t offset, size_t newEnd)
+    {
+        while (n > 0) {
+            size_t idx = WrapPolicy::Wrap(h.read_ptr + offset, length_);
+            size_t k   = newEnd - h.read_ptr;
+            k = k < (length_ - idx) ? k : (length_ - idx);
+            k = k < n ? k : n;
+            FormatPolicy::LoadBlock(store_.line, idx, out, k);
+            h.read_ptr = h.read_ptr + k < newEnd ? h.read_ptr + k : 0;
+            stats_.OnReadWrap(h.read_ptr == 0);
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** converts the clip window of a head to samples at the current loop length, bounded like
+     *  Read(clipStart, clipEnd, minClip), and brings the head back inside it
+    */
+    inline void ResolveClip(LoopHead& h)
+    {
+        LoopClip& c      = h.clip;
+        size_t    newEnd = (size_t) (c.end_now * length_);
+        newEnd           = newEnd < c.min ? c.min : newEnd;
+        newEnd           = newEnd >= length_ ? length_ : newEnd;
+        size_t offset    = (size_t) (c.start_now * length_);
+        c.offset         = offset < length_ ? offset : (length_ > 0 ? offset % length_ : 0);
+        c.samples        = newEnd;
+        c.length         = length_;
+        h.read_ptr       = h.read_ptr < newEnd ? h.read_ptr : 0;
+    }
+
+    /** one smoothing step from x towards target, landing on target once the step is too small to move x */
+    static inline float Glide(float x, float target, float smooth)
+    {
+        float y = x + (target - x) * smooth;
+        return y != x && smooth < 1.f ? y : target;
+    }
+
+    static inline size_t Advance(size_t ptr, int32_t step, size_t n) { return LoopAdvance(ptr, step, n); }
+
+    LoopHead    head_;
+    SpliceJob   splice_;
+    StatsPolicy stats_;
+    bool        lazy_;
+    size_t      valid_;
+    float       frac_;
+    size_t      write_ptr_;
+    size_t      length_;
+    LoopStorage<Word, kWords, max_size> store_;
 };
+
+/** LoopBuffer over caller-owned memory, see LoopBuffer::Init(void*, size_t) */
+template <typename T,
+          typename WrapPolicy   = LoopWrapCompare,
+          typename InterpPolicy = LoopInterpLinear,
+          typename FormatPolicy = LoopFormatNative<T>,
+          typename StatsPolicy  = LoopStatsNone>
+using LoopBufferView = LoopBuffer<T, 0, WrapPolicy, InterpPolicy, FormatPolicy, StatsPolicy>;
+
 } // namespace daisysp
 #endif
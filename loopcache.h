@@ -0,0 +1,255 @@
+#pragma once
+#ifndef DSY_LOOPCACHE_H
+#define DSY_LOOPCACHE_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** hit and miss counts of a LoopCache */
+struct LoopCacheStats
+{
+    uint32_t hits;   //samples read from a staged tile
+    uint32_t misses; //samples whose tile had to be fetched on the spot
+    uint32_t fills;  //tiles staged ahead of the heads by Prefetch()
+};
+
+/** Staging cache that keeps the regions around the active playheads in internal RAM.
+A loop of several minutes has to live in external SDRAM, where every scattered read pays the
+SDRAM latency. LoopCache holds tiles of tile_size samples, direct mapped onto tiles slots, and the
+block reads below stage the window a head is about to play before reading it, so the per-sample
+path only touches the cache. The tiles are held as T, which also moves the format conversion of
+int16/int24 storage off the per-sample path.
+
+Tiles are filled with a block copy at block boundaries. On hardware that copy is where a DMA
+transfer would go, the cache does not depend on one.
+
+declaration example: (the buffer in SDRAM, the cache in internal SRAM)
+
+LoopBuffer<float, SAMPLE_RATE * 60> DSY_SDRAM_BSS loop;
+LoopCache<LoopBuffer<float, SAMPLE_RATE * 60>> cache;
+
+cache.Init(&loop);
+...
+cache.ReadSpeedBlock(loop.GetHead(), out, size, speed);
+
+Writes must go through WriteBlock() or Overdub() here, or be followed by Invalidate(), so that
+staged tiles never hold stale audio.
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t tile_size = 256, size_t tiles = 16>
+class LoopCache
+{
+    static_assert((tile_size & (tile_size - 1)) == 0, "tile_size must be a power of two");
+    static_assert((tiles & (tiles - 1)) == 0, "tiles must be a power of two");
+
+  public:
+    typedef typename Buffer::SampleType T;
+    typedef typename Buffer::InterpType Interp;
+
+    LoopCache() {}
+    ~LoopCache() {}
+
+    /** attaches the cache to a buffer, with every slot empty and the counters cleared
+    */
+    void Init(Buffer* buffer)
+    {
+        buffer_ = buffer;
+        Invalidate();
+        ResetStats();
+    }
+
+    /** drops every staged tile, call after writing to the buffer behind the cache's back
+    */
+    void Invalidate()
+    {
+        for (size_t s = 0; s < tiles; s++) {
+            tag_[s] = kEmpty;
+        }
+    }
+
+    /** stages the tiles holding the n loop positions starting at position, wrapping at the loop length
+    */
+    void Prefetch(size_t position, size_t n)
+    {
+        size_t len = buffer_->GetLoopLength();
+        n          = n < len ? n : len;
+        position   = position < len ? position : position % len;
+        while (n > 0) {
+            size_t tile = position / tile_size;
+            size_t k    = (tile + 1) * tile_size - position;
+            k           = k < len - position ? k : len - position;
+            k           = k < n ? k : n;
+            size_t slot = tile & (tiles - 1);
+            if (tag_[slot] != tile) {
+                Fill(slot, tile);
+                stats_.fills++;
+            }
+            position = position + k < len ? position + k : 0;
+            n -= k;
+        }
+    }
+
+    /** stages the window a head reading n samples at speed will touch, interpolation taps included
+    */
+    void Prefetch(const LoopHead& h, float speed, size_t n)
+    {
+        size_t len  = buffer_->GetLoopLength();
+        size_t span = static_cast<size_t>(fabsf(speed) * n) + 2 + Interp::kBefore + Interp::kAfter;
+        size_t back = speed >= 0.f ? Interp::kBefore : span - Interp::kAfter;
+        size_t pos  = h.read_ptr < len ? h.read_ptr : 0;
+        Prefetch(LoopAdvance(pos, -static_cast<int32_t>(back < len ? back : len - 1), len), span);
+    }
+
+    /** returns the sample at position, fetching its tile if it is not staged
+    */
+    inline T Load(size_t position)
+    {
+        size_t tile = position / tile_size;
+        size_t slot = tile & (tiles - 1);
+        if (tag_[slot] != tile) {
+            Fill(slot, tile);
+            stats_.misses++;
+        } else {
+            stats_.hits++;
+        }
+        return data_[slot][position & (tile_size - 1)];
+    }
+
+    /** reads n samples like Buffer::ReadBlock(h, out, n), staging the block and the next one first
+    */
+    void ReadBlock(LoopHead& h, T* out, size_t n)
+    {
+        size_t len = buffer_->GetLoopLength();
+        h.read_ptr = h.read_ptr < len ? h.read_ptr : 0;
+        Prefetch(h.read_ptr, 2 * n);
+        while (n > 0) {
+            size_t tile = h.read_ptr / tile_size;
+            size_t off  = h.read_ptr & (tile_size - 1);
+            size_t k    = tile_size - off;
+            k           = k < len - h.read_ptr ? k : len - h.read_ptr;
+            k           = k < n ? k : n;
+            size_t slot = tile & (tiles - 1);
+            if (tag_[slot] != tile) {
+                Fill(slot, tile);
+                stats_.misses += k;
+            } else {
+                stats_.hits += k;
+            }
+            memcpy(out, &data_[slot][off], k * sizeof(T));
+            h.read_ptr = h.read_ptr + k < len ? h.read_ptr + k : 0;
+            out += k;
+            n -= k;
+        }
+    }
+
+    /** reads n samples like Buffer::ReadSpeedBlock(h, out, n, speed), staging the block and the next one first.
+     *  Glides to speed over the head's LoopHead::SetSpeedRamp() length, as the buffer does.
+    */
+    void ReadSpeedBlock(LoopHead& h, T* out, size_t n, float speed)
+    {
+        size_t    len = buffer_->GetLoopLength();
+        LoopRamp& r   = h.glide;
+        h.read_ptr    = h.read_ptr < len ? h.read_ptr : 0;
+        r.Set(speed);
+        //stage for the faster end of a ramp
+        Prefetch(h, fabsf(r.value) > fabsf(r.target) ? r.value : r.target, 2 * n);
+        for (size_t i = 0; i < n; i++) {
+            float   s    = r.Next() + h.frac;
+            int32_t step = static_cast<int32_t>(s);
+            step -= (s < static_cast<float>(step)); //floor without a libm call
+            h.read_ptr = LoopAdvance(h.read_ptr, step, len);
+            h.frac     = s - step;
+            out[i]     = Interpolate(h.read_ptr, h.frac, len);
+        }
+    }
+
+    /** writes n samples like Buffer::WriteBlock(), keeping the staged tiles it overwrites current
+    */
+    void WriteBlock(const T* in, size_t n)
+    {
+        size_t position = buffer_->GetWritePosition();
+        buffer_->WriteBlock(in, n);
+        Refresh(position, n, buffer_->GetCapacity());
+    }
+
+    /** overdubs n samples like Buffer::Overdub(in, n, feedback, inputGain), keeping the staged tiles current
+    */
+    void Overdub(const T* in, size_t n, float feedback, float inputGain)
+    {
+        size_t len      = buffer_->GetLoopLength();
+        size_t position = buffer_->GetWritePosition();
+        position        = position < len ? position : 0;
+        buffer_->Overdub(in, n, feedback, inputGain);
+        Refresh(position, n, len);
+    }
+
+    /** returns the hit and miss counts since the last ResetStats() */
+    inline const LoopCacheStats& GetStats() const { return stats_; }
+
+    /** returns the fraction of cached reads that found their tile staged, 1.0 before any read */
+    inline float GetHitRate() const
+    {
+        uint32_t total = stats_.hits + stats_.misses;
+        return total > 0 ? static_cast<float>(stats_.hits) / static_cast<float>(total) : 1.f;
+    }
+
+    /** clears the counters */
+    inline void ResetStats()
+    {
+        stats_.hits   = 0;
+        stats_.misses = 0;
+        stats_.fills  = 0;
+    }
+
+  private:
+    static const size_t kEmpty = SIZE_MAX;
+
+    /** copies a whole tile from the buffer into a slot */
+    inline void Fill(size_t slot, size_t tile)
+    {
+        size_t start = tile * tile_size;
+        size_t cap   = buffer_->GetCapacity();
+        size_t k     = cap - start < tile_size ? cap - start : tile_size;
+        buffer_->Peek(start, data_[slot], k);
+        tag_[slot] = tile;
+    }
+
+    /** copies n just written samples from position, wrapping at wrap, into the tiles that hold them */
+    void Refresh(size_t position, size_t n, size_t wrap)
+    {
+        while (n > 0) {
+            size_t tile = position / tile_size;
+            size_t off  = position & (tile_size - 1);
+            size_t k    = tile_size - off;
+            k           = k < wrap - position ? k : wrap - position;
+            k           = k < n ? k : n;
+            size_t slot = tile & (tiles - 1);
+            if (tag_[slot] == tile) {
+                buffer_->Peek(position, &data_[slot][off], k);
+            }
+            position = position + k < wrap ? position + k : 0;
+            n -= k;
+        }
+    }
+
+    /** gathers the interpolation taps around idx from the cache, wrapping at the loop length */
+    inline T Interpolate(size_t idx, float frac, size_t len)
+    {
+        T taps[Interp::kBefore + Interp::kAfter + 1];
+        for (size_t j = 0; j < Interp::kBefore + Interp::kAfter + 1; j++) {
+            taps[j] = Load(LoopAdvance(idx, static_cast<int32_t>(j) - static_cast<int32_t>(Interp::kBefore), len));
+        }
+        return Interp::Interpolate(taps + Interp::kBefore, frac);
+    }
+
+    Buffer*        buffer_;
+    LoopCacheStats stats_;
+    size_t         tag_[tiles];
+    T              data_[tiles][tile_size];
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,239 @@
+#pragma once
+#ifndef DSY_LOOPCONTROL_H
+#define DSY_LOOPCONTROL_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Lock-free queue for one producer and one consumer, for instance the main loop and the audio callback.
+Holds up to size - 1 items, size must be a power of two. Push and Pop never block, they fail instead.
+*/
+template <typename Item, size_t size>
+class LoopSpscQueue
+{
+    static_assert(size >= 2 && (size & (size - 1)) == 0, "size must be a power of two");
+
+  public:
+    LoopSpscQueue() : head_(0), tail_(0) {}
+
+    /** producer side, returns false if the queue is full */
+    bool Push(const Item& item)
+    {
+        size_t h    = head_.load(std::memory_order_relaxed);
+        size_t next = (h + 1) & (size - 1);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        items_[h] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /** consumer side, returns false if the queue is empty */
+    bool Pop(Item& item)
+    {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[t];
+        tail_.store((t + 1) & (size - 1), std::memory_order_release);
+        return true;
+    }
+
+    inline bool Empty() const
+    {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+    Item                items_[size];
+};
+
+/** Publishes a parameter struct from one thread to another without locks (a triple buffer).
+The writer always has a free slot to fill and the reader always sees the most recent complete value,
+never one that is half written.
+*/
+template <typename Params>
+class LoopParamSlot
+{
+  public:
+    LoopParamSlot() : back_(0), middle_(1), front_(2), valid_(false) {}
+
+    /** writer side: publishes p */
+    void Write(const Params& p)
+    {
+        slots_[back_] = p;
+        back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndex;
+    }
+
+    /** reader side: returns the most recent value, the same one again if nothing new was written.
+     *  Returns false if nothing was ever written.
+    */
+    bool Read(Params& p)
+    {
+        if (middle_.load(std::memory_order_acquire) & kFresh) {
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+            valid_ = true;
+        }
+        if (valid_) {
+            p = slots_[front_];
+        }
+        return valid_;
+    }
+
+  private:
+    static const uint32_t kIndex = 3;
+    static const uint32_t kFresh = 4;
+
+    uint32_t              back_;
+    std::atomic<uint32_t> middle_;
+    uint32_t              front_;
+    bool                  valid_;
+    Params                slots_[3];
+};
+
+/** a change to a LoopBuffer, queued by LoopControl */
+struct LoopCommand
+{
+    enum Type
+    {
+        SET_LENGTH,
+        SET_LENGTH_FRAC,
+        SET_READ_POSITION,
+        RESET,
+        SPLICE,
+        SPLICE_LOOP,
+        SET_CROSSFADE,
+    };
+
+    Type   type;
+    size_t a, b, c;
+    float  f;
+};
+
+/** Edits a LoopBuffer from the main loop while the audio callback keeps reading and writing it.
+The main loop queues changes here instead of calling the buffer. The callback calls Apply() at the start
+of every block, which applies them between two blocks, so length_ and the positions never change in the
+middle of a read. Splices run as incremental jobs (see LoopBuffer::StartSplice()), advanced by Apply().
+Apply() also publishes the buffer's state back, so the UI can show positions without touching the buffer.
+
+example:
+
+LoopControl<LoopBuffer<float, SAMPLE_RATE * 60>> control;
+control.Init(&loop);
+
+main loop:  control.SetLength(knob * SAMPLE_RATE * 60);
+callback:   control.Apply(); loop.ReadBlock(out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t queue_size = 32>
+class LoopControl
+{
+  public:
+    LoopControl() {}
+    ~LoopControl() {}
+
+    /** attaches the controller to a buffer, and sets how many samples each Apply() may splice */
+    void Init(Buffer* buffer, size_t spliceBudget = 256)
+    {
+        buffer_        = buffer;
+        splice_budget_ = spliceBudget;
+        dropped_       = 0;
+        rejected_      = 0;
+    }
+
+    /** main loop side. Each returns false, and counts the change as dropped, if the queue is full. */
+    bool SetLength(size_t length) { return Queue(LoopCommand::SET_LENGTH, length); }
+    bool Setlength(float length) { return Queue(LoopCommand::SET_LENGTH_FRAC, 0, 0, 0, length); }
+    bool SetReadPosition(size_t position) { return Queue(LoopCommand::SET_READ_POSITION, position); }
+    bool Reset() { return Queue(LoopCommand::RESET); }
+    bool SetCrossfade(size_t length) { return Queue(LoopCommand::SET_CROSSFADE, length); }
+    bool Splice() { return Queue(LoopCommand::SPLICE_LOOP); }
+    bool Splice(size_t fadeLength, size_t startPoint, size_t endPoint)
+    {
+        return Queue(LoopCommand::SPLICE, fadeLength, startPoint, endPoint);
+    }
+
+    /** audio side: applies every queued change, advances a running splice and publishes the state.
+     *  Call once per block before the buffer is read or written.
+     *  Lengths are clamped to [1..capacity], so a knob at 0 gives a one sample loop. Splices whose range does not
+     *  fit the loop are not started, and are counted by GetRejected().
+    */
+    void Apply()
+    {
+        LoopCommand c;
+        while (queue_.Pop(c)) {
+            switch (c.type) {
+                case LoopCommand::SET_LENGTH: buffer_->SetLength(c.a > 0 ? c.a : 1); break;
+                case LoopCommand::SET_LENGTH_FRAC: buffer_->Setlength(ClampLength(c.f)); break;
+                case LoopCommand::SET_READ_POSITION: buffer_->SetReadPosition(c.a); break;
+                case LoopCommand::RESET: buffer_->Reset(); break;
+                case LoopCommand::SPLICE:
+                    if (!buffer_->StartSplice(c.a, c.b, c.c)) {
+                        Reject();
+                    }
+                    break;
+                case LoopCommand::SPLICE_LOOP:
+                    if (!buffer_->StartSplice()) {
+                        Reject();
+                    }
+                    break;
+                case LoopCommand::SET_CROSSFADE: buffer_->GetHead().SetCrossfade(c.a); break;
+            }
+        }
+        if (buffer_->IsSplicing()) {
+            buffer_->SpliceStep(splice_budget_);
+        }
+        state_.Write(buffer_->GetState());
+    }
+
+    /** main loop side: returns the state published by the last Apply(), false before the first one */
+    inline bool GetState(LoopBufferState& state) { return state_.Read(state); }
+
+    /** returns the number of changes dropped because the queue was full */
+    inline uint32_t GetDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /** returns the number of splices Apply() did not start because their range did not fit the loop */
+    inline uint32_t GetRejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+  private:
+    /** a length in [1..capacity], NaN gives 1, so the conversion to an integer length stays defined */
+    inline float ClampLength(float length) const
+    {
+        float capacity = static_cast<float>(buffer_->GetCapacity());
+        return length >= 1.f ? (length < capacity ? length : capacity) : 1.f;
+    }
+
+    //audio side only, so a plain load and store
+    inline void Reject() { rejected_.store(rejected_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    bool Queue(LoopCommand::Type type, size_t a = 0, size_t b = 0, size_t c = 0, float f = 0.f)
+    {
+        LoopCommand cmd;
+        cmd.type = type;
+        cmd.a    = a;
+        cmd.b    = b;
+        cmd.c    = c;
+        cmd.f    = f;
+        if (!queue_.Push(cmd)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    Buffer*                                 buffer_;
+    size_t                                  splice_budget_;
+    std::atomic<uint32_t>                   dropped_;
+    std::atomic<uint32_t>                   rejected_;
+    LoopSpscQueue<LoopCommand, queue_size>  queue_;
+    LoopParamSlot<LoopBufferState>          state_;
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef DSY_LOOPFADE_H
+#define DSY_LOOPFADE_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+namespace daisysp
+{
+/** Equal-power crossfade window shared by every LoopBuffer.
+One quarter sine period, kSize + 1 floats, filled by Prepare() and read with linear interpolation.
+The fade-in gain is sin(t * pi / 2) and the fade-out gain is cos(t * pi / 2), so the summed power of
+two uncorrelated signals stays constant across the fade.
+
+By: Shahin Etemadzadeh
+*/
+struct LoopFade
+{
+    static const size_t kSize = 256;
+
+    /** fills the window table, only the first call does any work */
+    static void Prepare()
+    {
+        static bool ready = false;
+        if (ready) {
+            return;
+        }
+        const float kHalfPi = 1.57079632679490f;
+        float*      table   = Table();
+        for (size_t i = 0; i <= kSize; i++) {
+            table[i] = sinf(kHalfPi * static_cast<float>(i) / kSize);
+        }
+        ready = true;
+    }
+
+    /** returns the fade-in and fade-out gains at t in [0..1] */
+    static inline void Gains(float t, float& in, float& out)
+    {
+        in  = Lookup(t);
+        out = Lookup(1.f - t);
+    }
+
+    /** returns just the fade-in gain sin(t * pi / 2) at t in [0..1], also used to shape grain windows */
+    static inline float FadeIn(float t) { return Lookup(t); }
+
+  private:
+    static inline float Lookup(float t)
+    {
+        float  x = t * kSize;
+        size_t i = static_cast<size_t>(x);
+        i        = i < kSize ? i : kSize - 1;
+        float  f = x - static_cast<float>(i);
+        const float* w = Table();
+        return w[i] + (w[i + 1] - w[i]) * f;
+    }
+
+    static inline float* Table()
+    {
+        static float table[kSize + 1];
+        return table;
+    }
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef DSY_LOOPFILE_H
+#define DSY_LOOPFILE_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+namespace daisysp
+{
+/** File wrapper for LoopStream and LoopSnapshot on top of stdio, for the host and for targets with a stdio file system.
+On the Daisy the same four calls map onto FatFS:
+
+struct SdFile
+{
+    FIL    f;
+    size_t Read(void* dst, size_t bytes) { UINT n = 0; f_read(&f, dst, bytes, &n); return n; }
+    size_t Write(const void* src, size_t bytes) { UINT n = 0; f_write(&f, src, bytes, &n); return n; }
+    bool   Seek(size_t offset) { return f_lseek(&f, offset) == FR_OK; }
+    size_t Size() { return f_size(&f); }
+};
+*/
+struct LoopStdioFile
+{
+    FILE* f;
+
+    LoopStdioFile() : f(NULL) {}
+
+    /** opens path for reading, or truncates it for writing. Returns false if it cannot be opened. */
+    bool Open(const char* path, bool write)
+    {
+        f = fopen(path, write ? "w+b" : "rb");
+        return f != NULL;
+    }
+
+    void Close()
+    {
+        if (f != NULL) {
+            fclose(f);
+            f = NULL;
+        }
+    }
+
+    size_t Read(void* dst, size_t bytes) { return fread(dst, 1, bytes, f); }
+    size_t Write(const void* src, size_t bytes) { return fwrite(src, 1, bytes, f); }
+    bool   Seek(size_t offset) { return fseek(f, static_cast<long>(offset), SEEK_SET) == 0; }
+    size_t Size()
+    {
+        long here = ftell(f);
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, here, SEEK_SET);
+        return static_cast<size_t>(size);
+    }
+};
+} // namespace daisysp
+#endif
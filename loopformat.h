@@ -0,0 +1,164 @@
+#pragma once
+#ifndef DSY_LOOPFORMAT_H
+#define DSY_LOOPFORMAT_H
+#include <stdlib.h>
+#include <stdint.h>
+#include "loopkernels.h"
+namespace daisysp
+{
+/** Storage format policies for LoopBuffer.
+
+A format decides how samples are stored in the buffer, while the Read/Write/block APIs
+keep working with the buffer's sample type T. Storing float audio as int16_t halves the
+memory footprint and the SDRAM bandwidth per voice:
+
+LoopBuffer<float, SAMPLE_RATE * 60, LoopWrapCompare, LoopInterpLinear, LoopFormatInt16> del;
+
+Each format provides:
+- Word, the storage type, and kWordsPerSample words per stored sample
+- kInPlace, true when the words are T, so bulk kernels can work on the buffer without converting
+- kWavFormat, the WAV format tag of the stored words (1 for PCM, 3 for IEEE float), used by loopstream.h
+- Load/Store for a single sample at index i
+- LoadBlock/StoreBlock for n contiguous samples, written as plain loops the compiler can vectorize,
+  or with the kernels of loopkernels.h
+- Taps, which returns a pointer to count contiguous samples starting at i, converting them
+  into scratch when the storage type is not T
+
+By: Shahin Etemadzadeh
+*/
+
+/** stores samples as T, with no conversion. */
+template <typename T>
+struct LoopFormatNative
+{
+    typedef T Word;
+    static const size_t kWordsPerSample = 1;
+    static const bool   kInPlace        = true;
+    //floating point T keeps a fraction, integer T truncates it
+    static const uint16_t kWavFormat = T(0.5f) != T(0) ? 3 : 1;
+
+    static inline T Load(const Word* base, size_t i) { return base[i]; }
+
+    static inline void Store(Word* base, size_t i, T x) { base[i] = x; }
+
+    static inline void LoadBlock(const Word* base, size_t i, T* out, size_t n)
+    {
+        const Word* src = &base[i];
+        for (size_t j = 0; j < n; j++) {
+            out[j] = src[j];
+        }
+    }
+
+    static inline void StoreBlock(Word* base, size_t i, const T* in, size_t n)
+    {
+        Word* dst = &base[i];
+        for (size_t j = 0; j < n; j++) {
+            dst[j] = in[j];
+        }
+    }
+
+    static inline const T* Taps(const Word* base, size_t i, T* scratch, size_t count)
+    {
+        (void)scratch;
+        (void)count;
+        return &base[i];
+    }
+};
+
+/** stores float samples as 16 bit signed integers, scaled by 32768 and saturated.
+Loads and stores use the same scale and stores round to nearest, so a stored sample loads and stores
+back unchanged, and read-modify-write passes such as Overdub() at feedback 1 do not drift.
+*/
+struct LoopFormatInt16
+{
+    typedef int16_t Word;
+    static const size_t kWordsPerSample = 1;
+    static const bool   kInPlace        = false;
+    static const uint16_t kWavFormat = 1;
+
+    static inline float Load(const Word* base, size_t i) { return base[i] * kScale; }
+
+    static inline void Store(Word* base, size_t i, float x) { base[i] = FromFloat(x); }
+
+    static inline void LoadBlock(const Word* base, size_t i, float* out, size_t n)
+    {
+        LoopKernelInt16ToFloat(&base[i], out, n, kScale);
+    }
+
+    static inline void StoreBlock(Word* base, size_t i, const float* in, size_t n)
+    {
+        LoopKernelFloatToInt16(in, &base[i], n);
+    }
+
+    static inline const float* Taps(const Word* base, size_t i, float* scratch, size_t count)
+    {
+        LoadBlock(base, i, scratch, count);
+        return scratch;
+    }
+
+  private:
+    static constexpr float kScale = 1.f / 32768.f;
+
+    static inline Word FromFloat(float x) { return LoopFloatToInt16(x); }
+};
+
+/** stores float samples as packed little-endian 24 bit signed integers, 3 bytes per sample, scaled by 2^23 and saturated.
+A stored sample loads and stores back unchanged, as with LoopFormatInt16.
+*/
+struct LoopFormatInt24
+{
+    typedef uint8_t Word;
+    static const size_t kWordsPerSample = 3;
+    static const bool   kInPlace        = false;
+    static const uint16_t kWavFormat = 1;
+
+    static inline float Load(const Word* base, size_t i)
+    {
+        const Word* p = &base[i * 3];
+        int32_t     v = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8)
+                                         | (static_cast<uint32_t>(p[1]) << 16)
+                                         | (static_cast<uint32_t>(p[2]) << 24));
+        return (v >> 8) * kScale;
+    }
+
+    static inline void Store(Word* base, size_t i, float x)
+    {
+        Word*   p = &base[i * 3];
+        int32_t v = FromFloat(x);
+        p[0]      = static_cast<Word>(v);
+        p[1]      = static_cast<Word>(v >> 8);
+        p[2]      = static_cast<Word>(v >> 16);
+    }
+
+    static inline void LoadBlock(const Word* base, size_t i, float* out, size_t n)
+    {
+        for (size_t j = 0; j < n; j++) {
+            out[j] = Load(base, i + j);
+        }
+    }
+
+    static inline void StoreBlock(Word* base, size_t i, const float* in, size_t n)
+    {
+        for (size_t j = 0; j < n; j++) {
+            Store(base, i + j, in[j]);
+        }
+    }
+
+    static inline const float* Taps(const Word* base, size_t i, float* scratch, size_t count)
+    {
+        LoadBlock(base, i, scratch, count);
+        return scratch;
+    }
+
+  private:
+    static constexpr float kScale = 1.f / 8388608.f;
+
+    static inline int32_t FromFloat(float x)
+    {
+        float v = x * 8388608.f;
+        v       = !(v > -8388608.f) ? -8388608.f : (v >= 8388607.f ? 8388607.f : v); //NaN gives the lower bound, as LoopFloatToInt16()
+        return static_cast<int32_t>(v + (v < 0.f ? -0.5f : 0.5f));
+    }
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,276 @@
+#pragma once
+#ifndef DSY_LOOPGRAINS_H
+#define DSY_LOOPGRAINS_H
+#include <stdlib.h>
+#include <stdint.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Granular engine over a shared LoopBuffer.
+Keeps a fixed pool of up to max_grains grains. Each grain has its own start offset, length, speed and
+window, and reads the loop through its own LoopHead, so grains can overlap in any direction.
+The scheduler spawns grains at a density with random spray around a position, and
+ProcessBlock() renders them.
+
+The render loop allocates nothing. Windows come from the shared LoopFade table, and only live grains
+are visited: the pool is kept as one index list with the live grains first, so a spawn or a finished
+grain costs one swap. SetVoiceLimit() caps how many grains may sound at once, so a dense cloud
+stays within the audio deadline.
+
+declaration example:
+
+LoopBuffer<float, SAMPLE_RATE * 10> DSY_SDRAM_BSS loop;
+LoopGrains<LoopBuffer<float, SAMPLE_RATE * 10>, 32> cloud;
+
+cloud.Init(&loop, SAMPLE_RATE);
+cloud.SetDensity(40.f);       //grains per second
+cloud.SetSize(SAMPLE_RATE / 10);
+cloud.SetSpray(0.05f);
+...
+cloud.ProcessBlock(out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t max_grains = 32>
+class LoopGrains
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    /** shapes of the grain window */
+    enum Window
+    {
+        HANN,  //sin^2, smooth and the usual choice, two grains overlapping by half sum to a constant
+        SINE,  //half a sine period, sharper grains with more of the source's attack
+        TUKEY, //Hann edges over the first and last quarter, flat in between, for long grains
+    };
+
+    LoopGrains() {}
+    ~LoopGrains() {}
+
+    /** attaches the engine to a buffer, with no grain playing
+     *  float sampleRate - used to convert the density from grains per second
+    */
+    void Init(Buffer* buffer, float sampleRate)
+    {
+        buffer_       = buffer;
+        sample_rate_  = sampleRate;
+        position_     = 0.f;
+        spray_        = 0.f;
+        size_         = static_cast<size_t>(sampleRate * 0.1f);
+        size_jitter_  = 0.f;
+        speed_        = 1.f;
+        speed_jitter_ = 0.f;
+        gain_         = 1.f;
+        window_       = HANN;
+        num_active_   = 0;
+        limit_        = max_grains;
+        dropped_      = 0;
+        for (size_t i = 0; i < max_grains; i++) {
+            order_[i] = i;
+        }
+        SetDensity(0.f);
+        LoopFade::Prepare();
+    }
+
+    /** seeds the generator that draws grain offsets, sizes, speeds and onsets, for a reproducible cloud */
+    inline void Seed(uint32_t seed) { rng_.Seed(seed); }
+
+    /** sets where new grains start, [0..1.0] of the loop */
+    inline void SetPosition(float position) { position_ = position; }
+
+    /** sets how far past the position a grain may start at random, [0..1.0] of the loop */
+    inline void SetSpray(float spray) { spray_ = spray; }
+
+    /** sets the grain length in samples, and how much it varies at random, [0..1.0] of the length */
+    inline void SetSize(size_t samples, float jitter = 0.f)
+    {
+        size_        = samples > 0 ? samples : 1;
+        size_jitter_ = jitter;
+    }
+
+    /** sets the grain speed, negative plays grains in reverse, and how much it varies at random,
+     *  [0..1.0] of the speed
+    */
+    inline void SetSpeed(float speed, float jitter = 0.f)
+    {
+        speed_        = speed;
+        speed_jitter_ = jitter;
+    }
+
+    /** sets how many grains are spawned per second, 0 stops spawning. jitter [0..1.0] randomizes the onsets.
+    */
+    inline void SetDensity(float grainsPerSecond, float jitter = 0.f)
+    {
+        interval_        = grainsPerSecond > 0.f ? sample_rate_ / grainsPerSecond : 0.f;
+        interval_jitter_ = jitter;
+        countdown_       = NextInterval();
+    }
+
+    /** sets the window of new grains */
+    inline void SetWindow(Window window) { window_ = window; }
+
+    /** sets the gain of new grains */
+    inline void SetGain(float gain) { gain_ = gain; }
+
+    /** sets how many grains may play at once, at most max_grains. Spawns beyond it are dropped. */
+    inline void SetVoiceLimit(size_t limit) { limit_ = limit < max_grains ? limit : max_grains; }
+
+    /** spawns one grain now with the current settings. Returns false if the pool is full. */
+    bool Trigger()
+    {
+        size_t length = buffer_->GetLoopLength();
+        float  r      = rng_.NextFloat();
+        size_t offset = static_cast<size_t>((position_ + spray_ * r) * static_cast<float>(length));
+        float  size   = static_cast<float>(size_) * (1.f + size_jitter_ * (2.f * rng_.NextFloat() - 1.f));
+        float  speed  = speed_ * (1.f + speed_jitter_ * (2.f * rng_.NextFloat() - 1.f));
+        size_t n      = size >= 1.f ? static_cast<size_t>(size) : 1;
+        return Spawn(offset % (length > 0 ? length : 1), n, speed, gain_, window_);
+    }
+
+    /** spawns one grain with explicit settings, for a custom scheduler
+     *  size_t offset - where in the loop the grain starts, in samples
+     *  size_t length - grain length in samples
+     *  Returns false if the pool is full.
+    */
+    bool Spawn(size_t offset, size_t length, float speed, float gain, Window window)
+    {
+        if (num_active_ >= limit_ || length == 0) {
+            dropped_++;
+            return false;
+        }
+        Grain& g = grains_[order_[num_active_++]];
+        g.head.Reset();
+        buffer_->SetReadPosition(g.head, offset);
+        buffer_->SetPhaseSpeed(g.head, speed);
+        g.gain   = gain;
+        g.window = window;
+        g.age    = 0;
+        g.length = length;
+        g.step   = 1.f / static_cast<float>(length);
+        return true;
+    }
+
+    /** stops every grain at once */
+    inline void Clear() { num_active_ = 0; }
+
+    /** renders n samples of the cloud into out, spawning grains on the exact sample their onset falls on
+    */
+    void ProcessBlock(T* out, size_t n)
+    {
+        LoopKernelClear(out, n);
+        size_t i = 0;
+        while (i < n) {
+            size_t k = n - i;
+            if (interval_ > 0.f) {
+                k = k < countdown_ ? k : countdown_;
+            }
+            Render(out + i, k);
+            i += k;
+            if (interval_ > 0.f) {
+                countdown_ -= k;
+                if (countdown_ == 0) {
+                    Trigger();
+                    countdown_ = NextInterval();
+                }
+            }
+        }
+    }
+
+    /** returns the number of grains playing */
+    inline size_t GetActive() const { return num_active_; }
+
+    /** returns the number of grains dropped because the pool or the voice limit was full */
+    inline uint32_t GetDropped() const { return dropped_; }
+
+  private:
+    static const size_t kChunk = 64;
+
+    struct Grain
+    {
+        LoopHead head;   //read position in the loop, advanced by the fixed-point ReadPhase path
+        float    gain;
+        Window   window;
+        size_t   age;    //samples played
+        size_t   length; //samples in the grain
+        float    step;   //1 / length, the window advance per sample
+    };
+
+    /** window gain at t in [0..1] */
+    static inline float Shape(Window window, float t)
+    {
+        //distance from the nearest end, 0 at the ends and 1 in the middle
+        float u = t < 0.5f ? 2.f * t : 2.f * (1.f - t);
+        if (window == SINE) {
+            return LoopFade::FadeIn(u);
+        }
+        if (window == TUKEY) {
+            u = u < 0.5f ? 2.f * u : 1.f;
+        }
+        float s = LoopFade::FadeIn(u);
+        return s * s;
+    }
+
+    /** mixes k samples of every live grain into out, and retires the grains that end */
+    void Render(T* out, size_t k)
+    {
+        size_t a = 0;
+        while (a < num_active_) {
+            Grain& g    = grains_[order_[a]];
+            size_t left = g.length - g.age;
+            size_t m    = k < left ? k : left;
+            T      tmp[kChunk];
+            for (size_t done = 0; done < m;) {
+                size_t c = m - done < kChunk ? m - done : kChunk;
+                buffer_->ReadPhaseBlock(g.head, tmp, c);
+                for (size_t j = 0; j < c; j++) {
+                    tmp[j] *= Shape(g.window, static_cast<float>(g.age + j) * g.step);
+                }
+                LoopKernelMix(out + done, tmp, c, g.gain);
+                g.age += c;
+                done += c;
+            }
+            if (g.age >= g.length) {
+                //swap the finished grain behind the live ones, the grain swapped in is visited next
+                size_t last     = --num_active_;
+                size_t finished = order_[a];
+                order_[a]       = order_[last];
+                order_[last]    = finished;
+            } else {
+                a++;
+            }
+        }
+    }
+
+    /** returns the samples until the next onset, at least 1 */
+    inline size_t NextInterval()
+    {
+        if (interval_ <= 0.f) {
+            return 0;
+        }
+        float x = interval_ * (1.f + interval_jitter_ * (2.f * rng_.NextFloat() - 1.f));
+        return x >= 1.f ? static_cast<size_t>(x) : 1;
+    }
+
+    Buffer*    buffer_;
+    float      sample_rate_;
+    float      position_;
+    float      spray_;
+    size_t     size_;
+    float      size_jitter_;
+    float      speed_;
+    float      speed_jitter_;
+    float      gain_;
+    Window     window_;
+    float      interval_;        //samples between onsets, 0 when not spawning
+    float      interval_jitter_;
+    size_t     countdown_;       //samples until the next onset
+    size_t     limit_;
+    uint32_t   dropped_;
+    LoopRandom rng_;
+    Grain      grains_[max_grains];
+    size_t     order_[max_grains]; //grain indices, the first num_active_ are playing
+    size_t     num_active_;
+};
+} // namespace daisysp
+#endif
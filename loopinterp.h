@@ -0,0 +1,131 @@
+#pragma once
+#ifndef DSY_LOOPINTERP_H
+#define DSY_LOOPINTERP_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+namespace daisysp
+{
+/** Interpolation policies for the variable speed reads of LoopBuffer.
+
+Each policy reads kBefore taps before and kAfter taps after the sample at the integer
+position. Interpolate() is passed a pointer to that sample and the fractional position [0..1).
+The policy is chosen at compile time, so the per-sample loop has no branch on the quality:
+
+LoopBuffer<float, SAMPLE_RATE, LoopWrapCompare, LoopInterpHermite> del;
+
+By: Shahin Etemadzadeh
+*/
+
+/** no interpolation, returns the sample at the integer position. Fastest. */
+struct LoopInterpNone
+{
+    static const size_t kBefore = 0;
+    static const size_t kAfter  = 0;
+
+    static void Prepare() {}
+
+    template <typename T>
+    static inline T Interpolate(const T* x, float frac)
+    {
+        (void)frac;
+        return x[0];
+    }
+};
+
+/** linear interpolation between the sample at the integer position and the next one. */
+struct LoopInterpLinear
+{
+    static const size_t kBefore = 0;
+    static const size_t kAfter  = 1;
+
+    static void Prepare() {}
+
+    template <typename T>
+    static inline T Interpolate(const T* x, float frac)
+    {
+        return x[0] + (x[1] - x[0]) * frac;
+    }
+};
+
+/** 4-point, 3rd-order Hermite interpolation. */
+struct LoopInterpHermite
+{
+    static const size_t kBefore = 1;
+    static const size_t kAfter  = 2;
+
+    static void Prepare() {}
+
+    template <typename T>
+    static inline T Interpolate(const T* x, float frac)
+    {
+        T c1 = 0.5f * (x[1] - x[-1]);
+        T c2 = x[-1] - 2.5f * x[0] + 2.f * x[1] - 0.5f * x[2];
+        T c3 = 0.5f * (x[2] - x[-1]) + 1.5f * (x[0] - x[1]);
+        return ((c3 * frac + c2) * frac + c1) * frac + x[0];
+    }
+};
+
+/** 8-tap windowed-sinc interpolation from a polyphase table.
+The kernel is Blackman windowed with its cutoff just below Nyquist, and each phase is
+normalized to unity gain. The table (kPhases * kTaps floats) is filled by Prepare(),
+which LoopBuffer::Init() calls, so nothing is computed in the audio callback.
+*/
+struct LoopInterpSinc
+{
+    static const size_t kBefore = 3;
+    static const size_t kAfter  = 4;
+    static const size_t kTaps   = kBefore + kAfter + 1;
+    static const size_t kPhases = 256;
+
+    /** fills the polyphase table, only the first call does any work */
+    static void Prepare()
+    {
+        static bool ready = false;
+        if (ready) {
+            return;
+        }
+        const float kPi    = 3.14159265358979f;
+        const float cutoff = 0.9f;
+        const float half   = static_cast<float>(kAfter);
+        float*      table  = Table();
+        for (size_t p = 0; p < kPhases; p++) {
+            float frac = static_cast<float>(p) / kPhases;
+            float sum  = 0.f;
+            for (size_t j = 0; j < kTaps; j++) {
+                float x = static_cast<float>(j) - static_cast<float>(kBefore) - frac;
+                float s = x == 0.f ? 1.f : sinf(kPi * cutoff * x) / (kPi * cutoff * x);
+                float w = 0.42f + 0.5f * cosf(kPi * x / half) + 0.08f * cosf(2.f * kPi * x / half);
+                table[p * kTaps + j] = s * w;
+                sum += s * w;
+            }
+            for (size_t j = 0; j < kTaps; j++) {
+                table[p * kTaps + j] /= sum;
+            }
+        }
+        ready = true;
+    }
+
+    template <typename T>
+    static inline T Interpolate(const T* x, float frac)
+    {
+        size_t       p = static_cast<size_t>(frac * kPhases);
+        p              = p < kPhases ? p : kPhases - 1;
+        const float* c = &Table()[p * kTaps];
+        const T*     s = x - kBefore;
+        T            y = s[0] * c[0];
+        for (size_t j = 1; j < kTaps; j++) {
+            y += s[j] * c[j];
+        }
+        return y;
+    }
+
+  private:
+    static inline float* Table()
+    {
+        static float table[kPhases * kTaps];
+        return table;
+    }
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,391 @@
+#pragma once
+#ifndef DSY_LOOPKERNELS_H
+#define DSY_LOOPKERNELS_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DSY_LOOP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DSY_LOOP_NEON
+#endif
+namespace daisysp
+{
+/** Bulk kernels for LoopBuffer: fades, gain ramps, mixing, reversing, clearing and int16 conversion.
+
+Each kernel works on 4 samples at a time. Host builds use SSE2 or NEON. The Cortex-M7 has no
+float SIMD, so there the loops are unrolled by 4 like CMSIS-DSP, which keeps the FPU pipeline
+full and halves the loop overhead. Every kernel gives the same result as its scalar loop, so the
+block APIs stay equivalent to the per-sample ones.
+
+The float overloads are the vectorized ones. The templates cover other sample types with the
+unrolled scalar loop.
+
+By: Shahin Etemadzadeh
+*/
+
+/** x[j] *= g */
+template <typename T>
+inline void LoopKernelGain(T* x, size_t n, float g)
+{
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        x[j] *= g;
+        x[j + 1] *= g;
+        x[j + 2] *= g;
+        x[j + 3] *= g;
+    }
+    for (; j < n; j++) {
+        x[j] *= g;
+    }
+}
+
+inline void LoopKernelGain(float* x, size_t n, float g)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 vg = _mm_set1_ps(g);
+    for (; j + 4 <= n; j += 4) {
+        _mm_storeu_ps(x + j, _mm_mul_ps(_mm_loadu_ps(x + j), vg));
+    }
+#elif defined(DSY_LOOP_NEON)
+    for (; j + 4 <= n; j += 4) {
+        vst1q_f32(x + j, vmulq_n_f32(vld1q_f32(x + j), g));
+    }
+#else
+    for (; j + 4 <= n; j += 4) {
+        x[j] *= g;
+        x[j + 1] *= g;
+        x[j + 2] *= g;
+        x[j + 3] *= g;
+    }
+#endif
+    for (; j < n; j++) {
+        x[j] *= g;
+    }
+}
+
+/** x[j] *= (first + dir * j) * scale, a fade whose gains come from the integer sample index,
+ *  so that the result does not depend on how a long fade is split into calls. No divide per sample.
+*/
+template <typename T>
+inline void LoopKernelFade(T* x, size_t n, int32_t first, int32_t dir, float scale)
+{
+    for (size_t j = 0; j < n; j++) {
+        x[j] *= static_cast<float>(first + dir * static_cast<int32_t>(j)) * scale;
+    }
+}
+
+inline void LoopKernelFade(float* x, size_t n, int32_t first, int32_t dir, float scale)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128i idx  = _mm_setr_epi32(first, first + dir, first + 2 * dir, first + 3 * dir);
+    __m128i step = _mm_set1_epi32(4 * dir);
+    __m128  vs   = _mm_set1_ps(scale);
+    for (; j + 4 <= n; j += 4) {
+        __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(idx), vs);
+        _mm_storeu_ps(x + j, _mm_mul_ps(_mm_loadu_ps(x + j), g));
+        idx = _mm_add_epi32(idx, step);
+    }
+#elif defined(DSY_LOOP_NEON)
+    int32_t   start[4] = {first, first + dir, first + 2 * dir, first + 3 * dir};
+    int32x4_t idx      = vld1q_s32(start);
+    int32x4_t step     = vdupq_n_s32(4 * dir);
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t g = vmulq_n_f32(vcvtq_f32_s32(idx), scale);
+        vst1q_f32(x + j, vmulq_f32(vld1q_f32(x + j), g));
+        idx = vaddq_s32(idx, step);
+    }
+#else
+    int32_t i = first;
+    for (; j + 4 <= n; j += 4) {
+        x[j] *= static_cast<float>(i) * scale;
+        x[j + 1] *= static_cast<float>(i + dir) * scale;
+        x[j + 2] *= static_cast<float>(i + 2 * dir) * scale;
+        x[j + 3] *= static_cast<float>(i + 3 * dir) * scale;
+        i += 4 * dir;
+    }
+#endif
+    for (; j < n; j++) {
+        x[j] *= static_cast<float>(first + dir * static_cast<int32_t>(j)) * scale;
+    }
+}
+
+/** dst[j] += src[j] * g */
+template <typename T>
+inline void LoopKernelMix(T* dst, const T* src, size_t n, float g)
+{
+    for (size_t j = 0; j < n; j++) {
+        dst[j] += src[j] * g;
+    }
+}
+
+inline void LoopKernelMix(float* dst, const float* src, size_t n, float g)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 vg = _mm_set1_ps(g);
+    for (; j + 4 <= n; j += 4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(src + j), vg);
+        _mm_storeu_ps(dst + j, _mm_add_ps(_mm_loadu_ps(dst + j), p));
+    }
+#elif defined(DSY_LOOP_NEON)
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t p = vmulq_n_f32(vld1q_f32(src + j), g);
+        vst1q_f32(dst + j, vaddq_f32(vld1q_f32(dst + j), p));
+    }
+#else
+    for (; j + 4 <= n; j += 4) {
+        dst[j] += src[j] * g;
+        dst[j + 1] += src[j + 1] * g;
+        dst[j + 2] += src[j + 2] * g;
+        dst[j + 3] += src[j + 3] * g;
+    }
+#endif
+    for (; j < n; j++) {
+        dst[j] += src[j] * g;
+    }
+}
+
+/** dst[j] = dst[j] * (a0 + astep * (first + j)) + src[j] * b, the overdub mix with a linear feedback ramp.
+ *  The gain comes from the sample index instead of being accumulated, so it does not drift over
+ *  a long block and does not depend on how the ramp is split into calls.
+*/
+template <typename T>
+inline void LoopKernelRampMix(T* dst, const T* src, size_t n, float a0, float astep, float b, size_t first = 0)
+{
+    for (size_t j = 0; j < n; j++) {
+        dst[j] = dst[j] * (a0 + astep * static_cast<float>(first + j)) + src[j] * b;
+    }
+}
+
+inline void LoopKernelRampMix(float* dst, const float* src, size_t n, float a0, float astep, float b, size_t first = 0)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 va0  = _mm_set1_ps(a0);
+    __m128 vas  = _mm_set1_ps(astep);
+    __m128 vb   = _mm_set1_ps(b);
+    __m128 four = _mm_set1_ps(4.f);
+    __m128 vj   = _mm_add_ps(_mm_set1_ps(static_cast<float>(first)), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    for (; j + 4 <= n; j += 4) {
+        __m128 va = _mm_add_ps(va0, _mm_mul_ps(vas, vj));
+        __m128 p  = _mm_mul_ps(_mm_loadu_ps(dst + j), va);
+        _mm_storeu_ps(dst + j, _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(src + j), vb)));
+        vj = _mm_add_ps(vj, four);
+    }
+#elif defined(DSY_LOOP_NEON)
+    float       start[4] = {0.f, 1.f, 2.f, 3.f};
+    float32x4_t vj       = vaddq_f32(vld1q_f32(start), vdupq_n_f32(static_cast<float>(first)));
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t va = vaddq_f32(vdupq_n_f32(a0), vmulq_n_f32(vj, astep));
+        float32x4_t p  = vmulq_f32(vld1q_f32(dst + j), va);
+        vst1q_f32(dst + j, vaddq_f32(p, vmulq_n_f32(vld1q_f32(src + j), b)));
+        vj = vaddq_f32(vj, vdupq_n_f32(4.f));
+    }
+#else
+    for (; j + 4 <= n; j += 4) {
+        float fj   = static_cast<float>(first + j);
+        dst[j]     = dst[j] * (a0 + astep * fj) + src[j] * b;
+        dst[j + 1] = dst[j + 1] * (a0 + astep * (fj + 1.f)) + src[j + 1] * b;
+        dst[j + 2] = dst[j + 2] * (a0 + astep * (fj + 2.f)) + src[j + 2] * b;
+        dst[j + 3] = dst[j + 3] * (a0 + astep * (fj + 3.f)) + src[j + 3] * b;
+    }
+#endif
+    for (; j < n; j++) {
+        dst[j] = dst[j] * (a0 + astep * static_cast<float>(first + j)) + src[j] * b;
+    }
+}
+
+/** dst[j] = dst[j] * a[j] + src[j] * b, the overdub mix with a feedback per sample */
+template <typename T>
+inline void LoopKernelGainMix(T* dst, const float* a, const T* src, size_t n, float b)
+{
+    for (size_t j = 0; j < n; j++) {
+        dst[j] = dst[j] * a[j] + src[j] * b;
+    }
+}
+
+inline void LoopKernelGainMix(float* dst, const float* a, const float* src, size_t n, float b)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 vb = _mm_set1_ps(b);
+    for (; j + 4 <= n; j += 4) {
+        __m128 p = _mm_mul_ps(_mm_loadu_ps(dst + j), _mm_loadu_ps(a + j));
+        _mm_storeu_ps(dst + j, _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(src + j), vb)));
+    }
+#elif defined(DSY_LOOP_NEON)
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t p = vmulq_f32(vld1q_f32(dst + j), vld1q_f32(a + j));
+        vst1q_f32(dst + j, vaddq_f32(p, vmulq_n_f32(vld1q_f32(src + j), b)));
+    }
+#else
+    for (; j + 4 <= n; j += 4) {
+        dst[j]     = dst[j] * a[j] + src[j] * b;
+        dst[j + 1] = dst[j + 1] * a[j + 1] + src[j + 1] * b;
+        dst[j + 2] = dst[j + 2] * a[j + 2] + src[j + 2] * b;
+        dst[j + 3] = dst[j + 3] * a[j + 3] + src[j + 3] * b;
+    }
+#endif
+    for (; j < n; j++) {
+        dst[j] = dst[j] * a[j] + src[j] * b;
+    }
+}
+
+/** out[j] += x[j] * g, then x[j] = x[j] * a + in[j] * b: plays a span of the loop and overdubs it in one pass */
+template <typename T>
+inline void LoopKernelMixDub(T* x, const T* in, T* out, size_t n, float g, float a, float b)
+{
+    for (size_t j = 0; j < n; j++) {
+        out[j] += x[j] * g;
+        x[j] = x[j] * a + in[j] * b;
+    }
+}
+
+inline void LoopKernelMixDub(float* x, const float* in, float* out, size_t n, float g, float a, float b)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 vg = _mm_set1_ps(g);
+    __m128 va = _mm_set1_ps(a);
+    __m128 vb = _mm_set1_ps(b);
+    for (; j + 4 <= n; j += 4) {
+        __m128 v = _mm_loadu_ps(x + j);
+        _mm_storeu_ps(out + j, _mm_add_ps(_mm_loadu_ps(out + j), _mm_mul_ps(v, vg)));
+        _mm_storeu_ps(x + j, _mm_add_ps(_mm_mul_ps(v, va), _mm_mul_ps(_mm_loadu_ps(in + j), vb)));
+    }
+#elif defined(DSY_LOOP_NEON)
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t v = vld1q_f32(x + j);
+        vst1q_f32(out + j, vaddq_f32(vld1q_f32(out + j), vmulq_n_f32(v, g)));
+        vst1q_f32(x + j, vaddq_f32(vmulq_n_f32(v, a), vmulq_n_f32(vld1q_f32(in + j), b)));
+    }
+#else
+    for (; j + 4 <= n; j += 4) {
+        float x0 = x[j], x1 = x[j + 1], x2 = x[j + 2], x3 = x[j + 3];
+        out[j] += x0 * g;
+        out[j + 1] += x1 * g;
+        out[j + 2] += x2 * g;
+        out[j + 3] += x3 * g;
+        x[j]     = x0 * a + in[j] * b;
+        x[j + 1] = x1 * a + in[j + 1] * b;
+        x[j + 2] = x2 * a + in[j + 2] * b;
+        x[j + 3] = x3 * a + in[j + 3] * b;
+    }
+#endif
+    for (; j < n; j++) {
+        float v = x[j];
+        out[j] += v * g;
+        x[j] = v * a + in[j] * b;
+    }
+}
+
+/** reverses the order of x[0..n) */
+template <typename T>
+inline void LoopKernelReverse(T* x, size_t n)
+{
+    for (size_t a = 0, b = n; a + 1 < b; a++) {
+        b--;
+        T t  = x[a];
+        x[a] = x[b];
+        x[b] = t;
+    }
+}
+
+/** x[j] = 0 */
+template <typename T>
+inline void LoopKernelClear(T* x, size_t n)
+{
+    memset(x, 0, n * sizeof(T));
+}
+
+/** out[j] = in[j] * scale */
+inline void LoopKernelInt16ToFloat(const int16_t* in, float* out, size_t n, float scale)
+{
+    //the vector loops run to a bound computed up front, so GCC sees that the tail loop runs fewer than
+    //4 times and does not warn (-Waggressive-loop-optimizations) when n and the storage are known
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128       vs  = _mm_set1_ps(scale);
+    const size_t vec = n & ~static_cast<size_t>(7);
+    for (; j < vec; j += 8) {
+        __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + j));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + j, _mm_mul_ps(_mm_cvtepi32_ps(lo), vs));
+        _mm_storeu_ps(out + j + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vs));
+    }
+#elif defined(DSY_LOOP_NEON)
+    const size_t vec = n & ~static_cast<size_t>(3);
+    for (; j < vec; j += 4) {
+        int32x4_t v = vmovl_s16(vld1_s16(in + j));
+        vst1q_f32(out + j, vmulq_n_f32(vcvtq_f32_s32(v), scale));
+    }
+#else
+    const size_t vec = n & ~static_cast<size_t>(3);
+    for (; j < vec; j += 4) {
+        out[j]     = in[j] * scale;
+        out[j + 1] = in[j + 1] * scale;
+        out[j + 2] = in[j + 2] * scale;
+        out[j + 3] = in[j + 3] * scale;
+    }
+#endif
+    for (; j < n; j++) {
+        out[j] = in[j] * scale;
+    }
+}
+
+/** x * 32768 rounded to nearest (halves away from 0), saturated to [-32768..32767]. NaN gives -32768. */
+inline int16_t LoopFloatToInt16(float x)
+{
+    float v = x * 32768.f;
+    //NaN fails the first test, so the conversion below stays defined
+    v = !(v > -32768.f) ? -32768.f : (v >= 32767.f ? 32767.f : v);
+    return static_cast<int16_t>(v + (v < 0.f ? -0.5f : 0.5f));
+}
+
+/** out[j] = in[j] * 32768 rounded to nearest (halves away from 0), saturated to [-32768..32767], NaN to -32768.
+ *  The inverse of LoopKernelInt16ToFloat() with scale 1 / 32768, so stored samples load and store back unchanged.
+*/
+inline void LoopKernelFloatToInt16(const float* in, int16_t* out, size_t n)
+{
+    size_t j = 0;
+#if defined(DSY_LOOP_SSE2)
+    __m128 lo   = _mm_set1_ps(-32768.f);
+    __m128 hi   = _mm_set1_ps(32767.f);
+    __m128 k    = _mm_set1_ps(32768.f);
+    __m128 sign = _mm_set1_ps(-0.f);
+    __m128 half = _mm_set1_ps(0.5f);
+    for (; j + 8 <= n; j += 8) {
+        //_mm_max_ps() returns lo for NaN, as the scalar clamp does
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + j), k), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + j + 4), k), lo), hi);
+        //+-0.5 with the sign of the sample, then truncate, as the scalar loop does
+        a          = _mm_add_ps(a, _mm_or_ps(_mm_and_ps(a, sign), half));
+        b          = _mm_add_ps(b, _mm_or_ps(_mm_and_ps(b, sign), half));
+        __m128i ai = _mm_cvttps_epi32(a);
+        __m128i bi = _mm_cvttps_epi32(b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm_packs_epi32(ai, bi));
+    }
+#elif defined(DSY_LOOP_NEON)
+    const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+    const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t a  = vmulq_n_f32(vld1q_f32(in + j), 32768.f);
+        float32x4_t lo = vdupq_n_f32(-32768.f);
+        //vmaxq_f32() keeps NaN, so select lo where a > lo fails, as the scalar clamp does
+        a = vminq_f32(vbslq_f32(vcgtq_f32(a, lo), a, lo), vdupq_n_f32(32767.f));
+        a = vaddq_f32(a, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(a), sign), half)));
+        vst1_s16(out + j, vmovn_s32(vcvtq_s32_f32(a)));
+    }
+#endif
+    for (; j < n; j++) {
+        out[j] = LoopFloatToInt16(in[j]);
+    }
+}
+} // namespace daisysp
+#endif
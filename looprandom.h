@@ -0,0 +1,50 @@
+#pragma once
+#ifndef DSY_LOOPRANDOM_H
+#define DSY_LOOPRANDOM_H
+#include <stdlib.h>
+#include <stdint.h>
+namespace daisysp
+{
+/** Small, real-time safe xorshift32 generator for clip and grain randomization.
+Unlike libc rand() it takes no locks and touches no shared state, so it is safe in the
+audio callback, and each voice can be seeded to give a reproducible sequence.
+
+By: Shahin Etemadzadeh
+*/
+struct LoopRandom
+{
+    uint32_t state;
+
+    LoopRandom() { Seed(0); }
+
+    /** seeds the generator. Any value is allowed, including 0. */
+    inline void Seed(uint32_t seed)
+    {
+        //scramble so that nearby seeds give unrelated sequences; xorshift must not start at 0
+        uint32_t x = (seed + 0x9E3779B9u) * 0x85EBCA6Bu;
+        x ^= x >> 13;
+        state = x != 0 ? x : 0x6D2B79F5u;
+    }
+
+    /** returns the next 32 bit value */
+    inline uint32_t Next()
+    {
+        uint32_t x = state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        state = x;
+        return x;
+    }
+
+    /** returns a value in [0, n) using a multiply-shift instead of a modulo */
+    inline uint32_t Below(uint32_t n)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(Next()) * n) >> 32);
+    }
+
+    /** returns a float in [0..1) */
+    inline float NextFloat() { return static_cast<float>(Next() >> 8) * (1.f / 16777216.f); }
+};
+} // namespace daisysp
+#endif
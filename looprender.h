@@ -0,0 +1,433 @@
+#pragma once
+#ifndef DSY_LOOPRENDER_H
+#define DSY_LOOPRENDER_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "loopbuffer.h"
+#include "loopfile.h"
+#include "loopstream.h"
+namespace daisysp
+{
+/** one step of a LoopRender script */
+struct LoopRenderStep
+{
+    enum Type
+    {
+        RECORD,            //writes samples of the test input
+        OVERDUB,           //overdubs samples of the test input, f = feedback, g = input gain
+        READ,              //plays samples
+        READ_CLIP,         //plays samples of the clip f = start, g = end, a = minimum clip
+        READ_RANDOM,       //as READ_CLIP, with a random start and length drawn at every clip boundary
+        READ_SPEED,        //plays samples at speed f
+        READ_SPEED_CLIP,   //plays samples of the clip f = start, g = end at speed h, a = minimum clip
+        READ_PHASE,        //plays samples at the fixed-point speed f
+        SPLICE,            //fades a samples from b and towards c, the whole loop like Splice() when a is 0
+        SET_LENGTH,        //a = loop length
+        SET_READ_POSITION, //a = position of the playhead
+        SET_CROSSFADE,     //a = length of the clip crossfade of the playhead
+        SEED,              //a = seed of the playhead's random clips
+    };
+
+    Type   type;
+    size_t samples; //samples rendered by RECORD, OVERDUB and the reads
+    size_t a, b, c;
+    float  f, g, h;
+};
+
+/** outcome of a LoopRender run */
+struct LoopRenderResult
+{
+    bool     ok;             //the run completed, and matched when it was compared
+    size_t   samples;        //samples played by the reads, the length of the render
+    size_t   processed;      //samples through the buffer, recorded and overdubbed ones included
+    size_t   mismatches;     //samples that differ from the reference, a length difference included
+    size_t   first_mismatch; //index of the first one, SIZE_MAX if none
+    uint64_t ticks;          //time spent in the buffer, in LoopClock::Unit(), the input and output excluded
+};
+
+/** Offline render of a LoopBuffer through a scripted session, for regression tests and tuning on the host.
+A script records and overdubs a deterministic test signal, plays it back through the clip, random,
+speed and phase reads, and splices it. Every read is rendered into one output stream.
+
+The same script runs in one of two modes. PER_SAMPLE calls the per-sample API for every sample and
+splices at once. BLOCK calls the block APIs once per block and runs splices incrementally. The block
+APIs are documented as equivalent to their per-sample calls, so the two renders must match bit for bit.
+CompareModes() checks that. Render() writes a WAV file, and Compare() checks a render bit for bit against a
+golden WAV file written earlier, so an optimization can be checked against the output of the code it replaces.
+
+The test input uses integer arithmetic and LoopRandom only, no libm, so it is the same on every
+platform. The output is rendered faster than real time, and the result keeps the time spent inside the
+buffer, so GetSamplesPerSecond() gives the throughput on the host.
+
+declaration example: (host program)
+
+static LoopBuffer<float, 48000 * 4> loop;
+static float                        scratch[1 << 20];
+LoopRender<LoopBuffer<float, 48000 * 4>> render;
+
+size_t steps;
+const LoopRenderStep* script = render.DefaultScript(steps);
+render.Init(&loop, 48);
+render.Render(script, steps, render.BLOCK, "golden.wav");              //once, with the reference code
+LoopRenderResult r = render.Compare(script, steps, render.BLOCK, "golden.wav");
+LoopRenderResult m = render.CompareModes(script, steps, scratch, 1 << 20);
+printf("%s %s %.0f samples/s\n", r.ok ? "match" : "MISMATCH", m.ok ? "match" : "MISMATCH", render.GetSamplesPerSecond(r));
+
+The buffer should hold at least 48000 samples for DefaultScript().
+tests/looprender_test.cpp runs both checks on the host against tests/golden/looprender.wav: make -C tests test
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, typename File = LoopStdioFile>
+class LoopRender
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    enum Mode
+    {
+        PER_SAMPLE, //the per-sample API, the reference behavior
+        BLOCK,      //the block APIs
+    };
+
+    static const size_t kMaxBlock = 256;
+
+    LoopRender() {}
+    ~LoopRender() {}
+
+    /** attaches the renderer to a buffer
+     *  size_t blockSize - samples per block in BLOCK mode, at most kMaxBlock
+     *  uint32_t sampleRate - written to the WAV header
+    */
+    void Init(Buffer* buffer, size_t blockSize = 48, uint32_t sampleRate = 48000)
+    {
+        buffer_ = buffer;
+        block_  = blockSize < 1 ? 1 : (blockSize > kMaxBlock ? kMaxBlock : blockSize);
+        rate_   = sampleRate;
+    }
+
+    /** returns a script that covers every mode: record, overdub, plain, clip, random, speed, reverse,
+     *  crossfaded and phase reads, a splice and a shortened loop. About 7 seconds at 48kHz.
+    */
+    static const LoopRenderStep* DefaultScript(size_t& steps)
+    {
+        static const LoopRenderStep script[] = {
+            {LoopRenderStep::SEED, 0, 1, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::RECORD, 48000, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::SET_LENGTH, 0, 48000, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::OVERDUB, 48000, 0, 0, 0, 0.8f, 0.5f, 0.f},
+            {LoopRenderStep::SET_READ_POSITION, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ, 24000, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ_CLIP, 24000, 64, 0, 0, 0.25f, 0.5f, 0.f},
+            {LoopRenderStep::SEED, 0, 7, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ_RANDOM, 24000, 256, 0, 0, 0.5f, 0.5f, 0.f},
+            {LoopRenderStep::READ_SPEED, 24000, 0, 0, 0, 1.37f, 0.f, 0.f},
+            {LoopRenderStep::READ_SPEED, 24000, 0, 0, 0, -0.61f, 0.f, 0.f},
+            {LoopRenderStep::SET_CROSSFADE, 0, 64, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ_SPEED_CLIP, 24000, 64, 0, 0, 0.1f, 0.3f, 1.5f},
+            {LoopRenderStep::SET_CROSSFADE, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ_PHASE, 24000, 0, 0, 0, 0.75f, 0.f, 0.f},
+            {LoopRenderStep::SPLICE, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ, 48000, 0, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::SPLICE, 0, 1000, 2000, 40000, 0.f, 0.f, 0.f},
+            {LoopRenderStep::SET_LENGTH, 0, 30000, 0, 0, 0.f, 0.f, 0.f},
+            {LoopRenderStep::READ_SPEED, 24000, 0, 0, 0, 2.2f, 0.f, 0.f},
+            {LoopRenderStep::READ_CLIP, 24000, 64, 0, 0, 0.6f, 0.2f, 0.f},
+        };
+        steps = sizeof(script) / sizeof(script[0]);
+        return script;
+    }
+
+    /** runs a script and hands every rendered block to sink.Put(const T* x, size_t n), which returns
+     *  false to stop the run. The buffer is cleared first, so every run starts from the same state.
+    */
+    template <typename Sink>
+    LoopRenderResult Run(const LoopRenderStep* script, size_t steps, Mode mode, Sink& sink)
+    {
+        LoopRenderResult r;
+        r.ok             = true;
+        r.samples        = 0;
+        r.processed      = 0;
+        r.mismatches     = 0;
+        r.first_mismatch = SIZE_MAX;
+        r.ticks          = 0;
+
+        buffer_->Clear();
+        buffer_->Reset();
+        buffer_->GetHead().SetCrossfade(0);
+        buffer_->GetHead().SetSpeedRamp(0);
+        rng_.Seed(0);
+        time_ = 0;
+
+        T in[kMaxBlock];
+        T out[kMaxBlock];
+        for (size_t s = 0; s < steps && r.ok; s++) {
+            const LoopRenderStep& p = script[s];
+            if (!IsStream(p.type)) {
+                uint32_t start = LoopClock::Now();
+                Apply(p, mode);
+                r.ticks += LoopClock::Now() - start;
+                continue;
+            }
+            bool writes = p.type == LoopRenderStep::RECORD || p.type == LoopRenderStep::OVERDUB;
+            for (size_t i = 0; i < p.samples && r.ok; i += block_) {
+                size_t k = p.samples - i < block_ ? p.samples - i : block_;
+                if (writes) {
+                    Input(in, k);
+                }
+                uint32_t start = LoopClock::Now();
+                if (mode == BLOCK) {
+                    RenderBlock(p, in, out, k);
+                } else {
+                    RenderSamples(p, in, out, k);
+                }
+                r.ticks += LoopClock::Now() - start;
+                r.processed += k;
+                if (!writes) {
+                    r.ok = sink.Put(out, k);
+                    r.samples += k;
+                }
+            }
+        }
+        return r;
+    }
+
+    /** renders a script to a 32 bit float (or native format) WAV file. Returns a failed result if the
+     *  file cannot be written.
+    */
+    LoopRenderResult Render(const LoopRenderStep* script, size_t steps, Mode mode, const char* path)
+    {
+        WavSink sink;
+        bool    opened = sink.file.Open(path, true) && sink.stream.StartRecord(&sink.file, rate_);
+        LoopRenderResult r = Run(script, steps, mode, sink);
+        r.ok               = opened && sink.stream.StopRecord() && r.ok;
+        sink.file.Close();
+        return r;
+    }
+
+    /** renders a script and compares it bit for bit with a WAV file written by Render() */
+    LoopRenderResult Compare(const LoopRenderStep* script, size_t steps, Mode mode, const char* path)
+    {
+        GoldenSink sink;
+        bool       opened = sink.file.Open(path, false) && sink.stream.StartPlay(&sink.file, false);
+        sink.length       = opened ? sink.stream.GetLength() : 0;
+        sink.Start();
+        LoopRenderResult r = Run(script, steps, mode, sink);
+        Tally(r, sink, sink.length);
+        r.ok = opened && r.ok && r.mismatches == 0;
+        sink.stream.Stop();
+        sink.file.Close();
+        return r;
+    }
+
+    /** renders a script per sample into scratch, then in blocks, and compares the two bit for bit.
+     *  scratch must hold the whole render. The result is that of the block run.
+    */
+    LoopRenderResult CompareModes(const LoopRenderStep* script, size_t steps, T* scratch, size_t capacity)
+    {
+        MemorySink reference;
+        reference.data     = scratch;
+        reference.capacity = capacity;
+        reference.Start();
+        LoopRenderResult a = Run(script, steps, PER_SAMPLE, reference);
+
+        MemorySink block = reference;
+        block.compare    = true;
+        block.Start();
+        LoopRenderResult r = Run(script, steps, BLOCK, block);
+        Tally(r, block, a.samples);
+        r.ok = a.ok && r.ok && r.mismatches == 0;
+        return r;
+    }
+
+    /** returns the throughput of a run in samples per second, on the host where ticks are nanoseconds */
+    static inline double GetSamplesPerSecond(const LoopRenderResult& r)
+    {
+        return r.ticks > 0 ? static_cast<double>(r.processed) * 1e9 / static_cast<double>(r.ticks) : 0.0;
+    }
+
+  private:
+    typedef LoopStream<T, File, LoopFormatNative<T>, 1024, 4> Stream;
+
+    /** bitwise comparison state shared by the comparing sinks */
+    struct Checker
+    {
+        size_t compared;
+        size_t mismatches;
+        size_t first;
+
+        inline void Start()
+        {
+            compared   = 0;
+            mismatches = 0;
+            first      = SIZE_MAX;
+        }
+
+        inline void Check(const T* x, const T* ref, size_t n)
+        {
+            for (size_t i = 0; i < n; i++) {
+                if (memcmp(&x[i], &ref[i], sizeof(T)) != 0) {
+                    first = first == SIZE_MAX ? compared + i : first;
+                    mismatches++;
+                }
+            }
+            compared += n;
+        }
+    };
+
+    struct WavSink
+    {
+        File   file;
+        Stream stream;
+
+        inline bool Put(const T* x, size_t n)
+        {
+            stream.Write(x, n);
+            return stream.Service() && stream.GetOverruns() == 0;
+        }
+    };
+
+    struct GoldenSink : Checker
+    {
+        File   file;
+        Stream stream;
+        size_t length;
+
+        inline bool Put(const T* x, size_t n)
+        {
+            //the golden file ran out, the rest are counted by Tally()
+            size_t k = Checker::compared < length ? length - Checker::compared : 0;
+            k        = k < n ? k : n;
+            T ref[kMaxBlock];
+            stream.Service();
+            stream.Read(ref, k);
+            Checker::Check(x, ref, k);
+            return true;
+        }
+    };
+
+    struct MemorySink : Checker
+    {
+        T*     data;
+        size_t capacity;
+        bool   compare;
+
+        MemorySink() : data(NULL), capacity(0), compare(false) {}
+
+        inline bool Put(const T* x, size_t n)
+        {
+            if (Checker::compared + n > capacity) {
+                return false;
+            }
+            if (compare) {
+                Checker::Check(x, data + Checker::compared, n);
+            } else {
+                memcpy(data + Checker::compared, x, n * sizeof(T));
+                Checker::compared += n;
+            }
+            return true;
+        }
+    };
+
+    /** folds a checker into the result, counting a difference in length as mismatched samples */
+    static inline void Tally(LoopRenderResult& r, const Checker& c, size_t referenceLength)
+    {
+        r.mismatches     = c.mismatches;
+        r.first_mismatch = c.first;
+        size_t common    = r.samples < referenceLength ? r.samples : referenceLength;
+        if (r.samples != referenceLength) {
+            r.mismatches += r.samples > referenceLength ? r.samples - referenceLength : referenceLength - r.samples;
+            r.first_mismatch = r.first_mismatch < common ? r.first_mismatch : common;
+        }
+    }
+
+    static inline bool IsStream(LoopRenderStep::Type t) { return t <= LoopRenderStep::READ_PHASE; }
+
+    /** the test input: a triangle with a period of 400 / 3 samples plus white noise, integer and
+     *  LoopRandom arithmetic only, so it is the same on every platform
+    */
+    inline void Input(T* x, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            uint32_t ph  = (time_++ * 3u) % 400u;
+            float    tri = ph < 200u ? static_cast<float>(ph) : static_cast<float>(400u - ph);
+            float    v   = tri * (1.f / 200.f) - 0.5f + 0.25f * (rng_.NextFloat() - 0.5f);
+            x[i]         = static_cast<T>(v);
+        }
+    }
+
+    void Apply(const LoopRenderStep& p, Mode mode)
+    {
+        switch (p.type) {
+            case LoopRenderStep::SPLICE:
+                if (mode == BLOCK) {
+                    //the incremental job, one block's budget per step
+                    bool started = p.a == 0 ? buffer_->StartSplice() : buffer_->StartSplice(p.a, p.b, p.c);
+                    while (started && buffer_->IsSplicing()) {
+                        buffer_->SpliceStep(block_);
+                    }
+                } else if (p.a == 0) {
+                    buffer_->Splice();
+                } else {
+                    buffer_->Splice(static_cast<int>(p.a), static_cast<int>(p.b), static_cast<int>(p.c));
+                }
+                break;
+            case LoopRenderStep::SET_LENGTH: buffer_->SetLength(p.a); break;
+            case LoopRenderStep::SET_READ_POSITION: buffer_->SetReadPosition(p.a); break;
+            case LoopRenderStep::SET_CROSSFADE: buffer_->GetHead().SetCrossfade(p.a); break;
+            case LoopRenderStep::SEED: buffer_->GetHead().Seed(static_cast<uint32_t>(p.a)); break;
+            default: break;
+        }
+    }
+
+    void RenderBlock(const LoopRenderStep& p, const T* in, T* out, size_t n)
+    {
+        switch (p.type) {
+            case LoopRenderStep::RECORD: buffer_->WriteBlock(in, n); break;
+            case LoopRenderStep::OVERDUB: buffer_->Overdub(in, n, p.f, p.g); break;
+            case LoopRenderStep::READ: buffer_->ReadBlock(out, n); break;
+            case LoopRenderStep::READ_CLIP: buffer_->ReadBlock(out, n, p.f, p.g, p.a); break;
+            case LoopRenderStep::READ_RANDOM: buffer_->ReadBlock(out, n, p.f, p.g, p.a, true, true); break;
+            case LoopRenderStep::READ_SPEED: buffer_->ReadSpeedBlock(out, n, p.f); break;
+            case LoopRenderStep::READ_SPEED_CLIP:
+                buffer_->ReadBlock(out, n, p.f, p.g, p.h, p.a, false, false);
+                break;
+            case LoopRenderStep::READ_PHASE:
+                buffer_->SetPhaseSpeed(p.f);
+                buffer_->ReadPhaseBlock(out, n);
+                break;
+            default: break;
+        }
+    }
+
+    void RenderSamples(const LoopRenderStep& p, const T* in, T* out, size_t n)
+    {
+        if (p.type == LoopRenderStep::READ_PHASE) {
+            buffer_->SetPhaseSpeed(p.f);
+        }
+        for (size_t i = 0; i < n; i++) {
+            switch (p.type) {
+                case LoopRenderStep::RECORD: buffer_->Write(in[i]); break;
+                case LoopRenderStep::OVERDUB: buffer_->Overdub(in[i], p.f, p.g); break;
+                case LoopRenderStep::READ: out[i] = buffer_->Read(); break;
+                case LoopRenderStep::READ_CLIP: out[i] = buffer_->Read(p.f, p.g, p.a); break;
+                case LoopRenderStep::READ_RANDOM: out[i] = buffer_->Read(p.f, p.g, p.a, true, true); break;
+                case LoopRenderStep::READ_SPEED: out[i] = buffer_->ReadSpeed(p.f); break;
+                case LoopRenderStep::READ_SPEED_CLIP:
+                    out[i] = buffer_->Read(p.f, p.g, p.h, p.a, false, false);
+                    break;
+                case LoopRenderStep::READ_PHASE: out[i] = buffer_->ReadPhase(); break;
+                default: break;
+            }
+        }
+    }
+
+    Buffer*    buffer_;
+    size_t     block_;
+    uint32_t   rate_;
+    uint32_t   time_; //samples of test input generated
+    LoopRandom rng_;  //noise of the test input
+};
+} // namespace daisysp
+#endif
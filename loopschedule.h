@@ -0,0 +1,266 @@
+#pragma once
+#ifndef DSY_LOOPSCHEDULE_H
+#define DSY_LOOPSCHEDULE_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include "loopbuffer.h"
+#include "loopcontrol.h"
+namespace daisysp
+{
+/** a change to a LoopBuffer, applied by LoopSchedule at an exact sample time */
+struct LoopEvent
+{
+    enum Type
+    {
+        SET_LENGTH,        //value is the new loop length in samples
+        SET_READ_POSITION, //value is the position to jump to in samples
+        RECORD_START,      //clears the loop and records from the input
+        RECORD_STOP,       //ends the recording, the loop is exactly the samples recorded, and plays from its start
+    };
+
+    Type     type;
+    uint32_t time;  //sample time, see LoopSchedule::GetTime()
+    size_t   value;
+};
+
+/** Sample-accurate transport for a LoopBuffer, with optional quantization to a tempo grid.
+Length changes, read jumps and record start/stop are queued with a sample time. Process() splits the
+block at those times, so each one happens on its exact sample whatever the block size, instead of at
+the first block boundary after the control code calls the buffer. Several tracks that are scheduled
+against the same grid stay locked to the sample.
+
+Time is a 32 bit sample counter advanced by Process(). It wraps after about a day at 48kHz, and times
+are compared modulo 2^32, so each event must be within about 12 hours of now.
+
+The main loop schedules, the audio callback runs Process(). Events pass through a lock-free queue
+(LoopSpscQueue from loopcontrol.h), and GetTime() is published atomically, so neither side blocks.
+Events whose time has already passed are applied at the start of the next block.
+
+declaration example: (record exactly 4 bars at 120 bpm, starting and stopping on a bar line)
+
+LoopSchedule<LoopBuffer<float, SAMPLE_RATE * 60>> transport;
+transport.Init(&loop, SAMPLE_RATE);
+transport.SetTempo(120.f, 4);
+transport.SetQuantize(transport.BAR);
+
+main loop:  transport.ScheduleQuantized(LoopEvent::RECORD_START);
+            transport.Schedule(LoopEvent::RECORD_STOP, transport.Quantize(transport.GetTime()) + transport.BarsToSamples(4));
+callback:   transport.Process(in, out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, size_t max_events = 16>
+class LoopSchedule
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    /** grid that ScheduleQuantized() and Quantize() snap to */
+    enum Grid
+    {
+        NONE,
+        BEAT,
+        BAR,
+    };
+
+    LoopSchedule() {}
+    ~LoopSchedule() {}
+
+    /** attaches the transport to a buffer, playing, at time 0, 120 bpm in 4/4 with no quantization */
+    void Init(Buffer* buffer, float sampleRate)
+    {
+        buffer_      = buffer;
+        sample_rate_ = sampleRate;
+        recording_   = false;
+        recorded_    = 0;
+        count_       = 0;
+        origin_      = 0;
+        grid_        = NONE;
+        dropped_     = 0;
+        now_.store(0, std::memory_order_relaxed);
+        SetTempo(120.f, 4);
+    }
+
+    /** sets the tempo of the grid
+     *  float bpm - beats per minute
+     *  size_t beatsPerBar - length of a bar in beats
+    */
+    inline void SetTempo(float bpm, size_t beatsPerBar)
+    {
+        beat_          = bpm > 0.f ? 60.0 * sample_rate_ / bpm : 0.0;
+        beats_per_bar_ = beatsPerBar > 0 ? beatsPerBar : 1;
+    }
+
+    /** sets the grid used by ScheduleQuantized() and Quantize() */
+    inline void SetQuantize(Grid grid) { grid_ = grid; }
+
+    /** moves the grid so that a beat falls on time, for instance on an incoming clock or downbeat */
+    inline void SetOrigin(uint32_t time) { origin_ = time; }
+
+    /** returns the current sample time, the time of the first sample of the next block */
+    inline uint32_t GetTime() const { return now_.load(std::memory_order_acquire); }
+
+    /** returns the first grid point at or after time, or time itself without quantization */
+    uint32_t Quantize(uint32_t time) const
+    {
+        double q = grid_ == BAR ? beat_ * beats_per_bar_ : beat_;
+        if (grid_ == NONE || q <= 0.0) {
+            return time;
+        }
+        //signed distance from the origin, so times before it snap too
+        double d = static_cast<double>(static_cast<int32_t>(time - origin_));
+        double k = ceil(d / q);
+        //grid points are rounded to whole samples, so the point before k * q may already be at or after time
+        if (floor((k - 1.0) * q + 0.5) >= d) {
+            k -= 1.0;
+        }
+        return origin_ + static_cast<uint32_t>(static_cast<int64_t>(floor(k * q + 0.5)));
+    }
+
+    /** returns the length in samples of a number of beats or bars at the current tempo, rounded to the sample */
+    inline size_t BeatsToSamples(float beats) const { return static_cast<size_t>(beats * beat_ + 0.5); }
+    inline size_t BarsToSamples(float bars) const
+    {
+        return static_cast<size_t>(bars * beat_ * beats_per_bar_ + 0.5);
+    }
+
+    /** main loop side: queues an event at an exact sample time. Returns false, and counts it as dropped,
+     *  if the queue is full.
+    */
+    bool Schedule(LoopEvent::Type type, uint32_t time, size_t value = 0)
+    {
+        LoopEvent e;
+        e.type  = type;
+        e.time  = time;
+        e.value = value;
+        if (!queue_.Push(e)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /** main loop side: queues an event on the next grid point, or as soon as possible without quantization */
+    inline bool ScheduleQuantized(LoopEvent::Type type, size_t value = 0)
+    {
+        return Schedule(type, Quantize(GetTime()), value);
+    }
+
+    /** audio side: records in or plays the loop into out for n samples, applying every event on its sample.
+     *  out plays silence while recording. in may be NULL if nothing is ever recorded.
+    */
+    void Process(const T* in, T* out, size_t n)
+    {
+        Drain();
+        uint32_t start = now_.load(std::memory_order_relaxed);
+        size_t   i     = 0;
+        while (i < n) {
+            //apply everything due by this sample, then run up to the next event
+            uint32_t t = start + static_cast<uint32_t>(i);
+            while (count_ > 0 && static_cast<int32_t>(events_[count_ - 1].time - t) <= 0) {
+                Apply(events_[--count_]);
+            }
+            size_t k = n - i;
+            if (count_ > 0) {
+                size_t d = static_cast<size_t>(events_[count_ - 1].time - t);
+                k        = d < k ? d : k;
+            }
+            Run(in != NULL ? in + i : NULL, out + i, k);
+            i += k;
+        }
+        now_.store(start + static_cast<uint32_t>(n), std::memory_order_release);
+    }
+
+    /** audio side: forgets every event not yet applied */
+    inline void Cancel()
+    {
+        LoopEvent e;
+        while (queue_.Pop(e)) {}
+        count_ = 0;
+    }
+
+    /** returns true while recording */
+    inline bool IsRecording() const { return recording_; }
+
+    /** returns the number of events dropped because a queue was full */
+    inline uint32_t GetDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    /** moves the queued events into the pending list, kept sorted with the earliest last */
+    void Drain()
+    {
+        LoopEvent e;
+        uint32_t  now = now_.load(std::memory_order_relaxed);
+        while (queue_.Pop(e)) {
+            if (count_ == max_events) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            //events at the same time keep the order they were scheduled in
+            int32_t when = static_cast<int32_t>(e.time - now);
+            size_t  j    = count_;
+            while (j > 0 && static_cast<int32_t>(events_[j - 1].time - now) <= when) {
+                events_[j] = events_[j - 1];
+                j--;
+            }
+            events_[j] = e;
+            count_++;
+        }
+    }
+
+    void Apply(const LoopEvent& e)
+    {
+        switch (e.type) {
+            case LoopEvent::SET_LENGTH: buffer_->SetLength(e.value > 0 ? e.value : 1); break;
+            case LoopEvent::SET_READ_POSITION: buffer_->SetReadPosition(e.value); break;
+            case LoopEvent::RECORD_START:
+                buffer_->Reset();
+                recording_ = true;
+                recorded_  = 0;
+                break;
+            case LoopEvent::RECORD_STOP:
+                if (recording_) {
+                    //a recording longer than the buffer keeps its last capacity samples, oldest at the write pointer
+                    size_t capacity = buffer_->GetCapacity();
+                    recording_      = false;
+                    if (recorded_ >= capacity) {
+                        buffer_->SetLength(capacity);
+                        buffer_->SetReadPosition(buffer_->GetWritePosition());
+                    } else {
+                        buffer_->SetLength(recorded_ > 0 ? recorded_ : 1);
+                        buffer_->SetReadPosition(0);
+                    }
+                }
+                break;
+        }
+    }
+
+    inline void Run(const T* in, T* out, size_t k)
+    {
+        if (recording_ && in != NULL) {
+            buffer_->WriteBlock(in, k);
+            recorded_ += k;
+            LoopKernelClear(out, k);
+        } else {
+            buffer_->ReadBlock(out, k);
+        }
+    }
+
+    Buffer*                              buffer_;
+    float                                sample_rate_;
+    double                               beat_;          //samples per beat
+    size_t                               beats_per_bar_;
+    uint32_t                             origin_;        //a time the grid passes through
+    Grid                                 grid_;
+    bool                                 recording_;
+    size_t                               recorded_;      //samples recorded since RECORD_START
+    std::atomic<uint32_t>                now_;
+    std::atomic<uint32_t>                dropped_;
+    LoopSpscQueue<LoopEvent, max_events> queue_;
+    LoopEvent                            events_[max_events]; //pending, sorted with the earliest last
+    size_t                               count_;
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,343 @@
+#pragma once
+#ifndef DSY_LOOPSNAPSHOT_H
+#define DSY_LOOPSNAPSHOT_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "loopbuffer.h"
+#include "loopfile.h"
+namespace daisysp
+{
+/** Saves and restores a LoopBuffer, its positions and the recorded samples, in small steps.
+
+A snapshot is a 48 byte header holding LoopBufferState followed by the loop's length samples,
+and nothing past the end of the loop. The samples are stored in one of three encodings:
+- FLOAT32, lossless
+- PCM16, half the size
+- ADPCM, IMA ADPCM at 4 bits per sample, an eighth of the size
+
+Save and load are split into steps of a bounded number of samples, so a long loop can be written
+from the main loop without stalling the UI. A load takes ceil(length / maxSamples) steps after
+BeginLoad(), and the buffer is ready once IsDone() is true. Do not play the buffer while it is being
+loaded. Recording into it while it is being saved mixes old and new audio into the snapshot.
+
+The File policy is the one used by LoopStream (see loopfile.h). All fields are little-endian.
+
+example:
+
+LoopSnapshot<LoopBuffer<float, SAMPLE_RATE * 60>, SdFile> snap;
+snap.BeginSave(&loop, &file, LoopSnapshot<...>::ADPCM);
+while (!snap.IsDone()) { snap.Step(4096); UpdateUi(); }
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer, typename File>
+class LoopSnapshot
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    enum Encoding
+    {
+        FLOAT32,
+        PCM16,
+        ADPCM,
+    };
+
+    static const uint32_t kMagic      = 0x504F4F4C; //"LOOP"
+    static const uint16_t kVersion    = 1;
+    static const size_t   kHeaderSize = 48;
+
+    LoopSnapshot() : mode_(IDLE), ok_(true) {}
+    ~LoopSnapshot() {}
+
+    /** writes the header of a snapshot of buffer, the samples follow with Step().
+     *  Returns false if the header cannot be written.
+    */
+    bool BeginSave(Buffer* buffer, File* file, Encoding encoding)
+    {
+        Begin(buffer, file, encoding);
+        state_ = buffer->GetState();
+        uint8_t h[kHeaderSize];
+        memset(h, 0, sizeof(h));
+        Put32(h, kMagic);
+        Put16(h + 4, kVersion);
+        Put16(h + 6, static_cast<uint32_t>(encoding));
+        Put32(h + 8, static_cast<uint32_t>(state_.length));
+        PutFloat(h + 12, state_.length_frac);
+        Put32(h + 16, static_cast<uint32_t>(state_.write_ptr));
+        Put32(h + 20, static_cast<uint32_t>(state_.read_ptr));
+        PutFloat(h + 24, state_.read_frac);
+        Put32(h + 28, state_.phase);
+        Put32(h + 32, static_cast<uint32_t>(static_cast<uint64_t>(state_.increment)));
+        Put32(h + 36, static_cast<uint32_t>(static_cast<uint64_t>(state_.increment) >> 32));
+        ok_   = file->Seek(0) && file->Write(h, kHeaderSize) == kHeaderSize;
+        mode_ = ok_ ? SAVING : IDLE;
+        return ok_;
+    }
+
+    /** reads the header of a snapshot and restores the positions and length into buffer, the samples follow
+     *  with Step(). Returns false if the file is not a snapshot or the loop does not fit the buffer.
+    */
+    bool BeginLoad(Buffer* buffer, File* file)
+    {
+        uint8_t h[kHeaderSize];
+        mode_ = IDLE;
+        ok_   = file->Seek(0) && file->Read(h, kHeaderSize) == kHeaderSize && Get32(h) == kMagic
+              && Get16(h + 4) == kVersion && Get16(h + 6) <= ADPCM;
+        if (!ok_) {
+            return false;
+        }
+        Begin(buffer, file, static_cast<Encoding>(Get16(h + 6)));
+        state_.length      = Get32(h + 8);
+        state_.length_frac = GetFloat(h + 12);
+        state_.write_ptr   = Get32(h + 16);
+        state_.read_ptr    = Get32(h + 20);
+        state_.read_frac   = GetFloat(h + 24);
+        state_.phase       = Get32(h + 28);
+        state_.increment   = static_cast<int64_t>(Get32(h + 32) | (static_cast<uint64_t>(Get32(h + 36)) << 32));
+        if (state_.length < 1 || state_.length > buffer->GetCapacity()) {
+            ok_ = false;
+            return false;
+        }
+        buffer->SetState(state_);
+        mode_ = LOADING;
+        return true;
+    }
+
+    /** saves or loads at most maxSamples more samples. Returns true while there is work left.
+     *  ADPCM packs two samples per byte, so its budget is rounded down to whole pairs, and a budget of 1 does one pair.
+    */
+    bool Step(size_t maxSamples)
+    {
+        if (mode_ == IDLE) {
+            return false;
+        }
+        if (encoding_ == ADPCM) {
+            maxSamples = maxSamples > 1 ? maxSamples & ~static_cast<size_t>(1) : 2;
+        }
+        //every chunk is then even, but for the last sample of an odd length
+        size_t n = state_.length - pos_;
+        n        = n < maxSamples ? n : maxSamples;
+        while (n > 0 && ok_) {
+            size_t k = n < kChunk ? n : kChunk;
+            if (mode_ == SAVING) {
+                buffer_->Peek(pos_, samples_, k);
+                size_t bytes = Encode(samples_, k, bytes_);
+                ok_          = file_->Write(bytes_, bytes) == bytes;
+            } else {
+                size_t bytes = EncodedBytes(k);
+                ok_          = file_->Read(bytes_, bytes) == bytes;
+                if (!ok_) {
+                    //a short read leaves the loop as it was, never half-read bytes
+                    break;
+                }
+                Decode(bytes_, k, samples_);
+                buffer_->Poke(pos_, samples_, k);
+            }
+            pos_ += k;
+            n = n > k ? n - k : 0;
+        }
+        if (pos_ == state_.length || !ok_) {
+            mode_ = IDLE;
+        }
+        return mode_ != IDLE;
+    }
+
+    /** returns true once the last step has run, or an error stopped the snapshot */
+    inline bool IsDone() const { return mode_ == IDLE; }
+
+    /** returns false if a read or write failed */
+    inline bool IsOk() const { return ok_; }
+
+    /** returns how much of the samples are saved or loaded, [0..1.0] */
+    inline float GetProgress() const
+    {
+        return state_.length > 0 ? static_cast<float>(pos_) / static_cast<float>(state_.length) : 1.f;
+    }
+
+    /** returns the size of the snapshot file of length samples */
+    static inline size_t GetFileSize(size_t length, Encoding encoding)
+    {
+        return kHeaderSize + (encoding == FLOAT32 ? length * 4 : (encoding == PCM16 ? length * 2 : (length + 1) / 2));
+    }
+
+  private:
+    enum Mode
+    {
+        IDLE,
+        SAVING,
+        LOADING,
+    };
+
+    static const size_t kChunk = 256;
+
+    inline void Begin(Buffer* buffer, File* file, Encoding encoding)
+    {
+        buffer_     = buffer;
+        file_       = file;
+        encoding_   = encoding;
+        pos_        = 0;
+        predictor_  = 0;
+        step_index_ = 0;
+    }
+
+    inline size_t EncodedBytes(size_t n) const
+    {
+        return encoding_ == FLOAT32 ? n * 4 : (encoding_ == PCM16 ? n * 2 : (n + 1) / 2);
+    }
+
+    //the scale of LoopFormatInt16, so a PCM16 snapshot of an int16 buffer restores it exactly
+    static inline int16_t ToPcm(float x) { return LoopFloatToInt16(x); }
+
+    size_t Encode(const T* in, size_t n, uint8_t* out)
+    {
+        switch (encoding_) {
+            case FLOAT32:
+                for (size_t i = 0; i < n; i++) {
+                    PutFloat(out + 4 * i, static_cast<float>(in[i]));
+                }
+                break;
+            case PCM16:
+                for (size_t i = 0; i < n; i++) {
+                    Put16(out + 2 * i, static_cast<uint16_t>(ToPcm(static_cast<float>(in[i]))));
+                }
+                break;
+            case ADPCM:
+                for (size_t i = 0; i < n; i += 2) {
+                    uint8_t lo = AdpcmEncode(ToPcm(static_cast<float>(in[i])));
+                    uint8_t hi = i + 1 < n ? AdpcmEncode(ToPcm(static_cast<float>(in[i + 1]))) : 0;
+                    out[i / 2] = static_cast<uint8_t>(lo | (hi << 4));
+                }
+                break;
+        }
+        return EncodedBytes(n);
+    }
+
+    void Decode(const uint8_t* in, size_t n, T* out)
+    {
+        switch (encoding_) {
+            case FLOAT32:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = static_cast<T>(GetFloat(in + 4 * i));
+                }
+                break;
+            case PCM16:
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = static_cast<T>(static_cast<int16_t>(Get16(in + 2 * i)) * (1.f / 32768.f));
+                }
+                break;
+            case ADPCM:
+                for (size_t i = 0; i < n; i++) {
+                    uint8_t code = (in[i / 2] >> ((i & 1) * 4)) & 0x0F;
+                    out[i]       = static_cast<T>(AdpcmDecode(code) * (1.f / 32768.f));
+                }
+                break;
+        }
+    }
+
+    /** IMA ADPCM, the encoder tracks the decoder exactly so the state carries across chunks */
+    uint8_t AdpcmEncode(int16_t sample)
+    {
+        int32_t step = StepTable()[step_index_];
+        int32_t diff = sample - predictor_;
+        uint8_t code = 0;
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+        if (diff >= step) {
+            code |= 4;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 2;
+            diff -= step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 1;
+        }
+        AdpcmDecode(code);
+        return code;
+    }
+
+    int16_t AdpcmDecode(uint8_t code)
+    {
+        static const int8_t kIndex[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+        int32_t step = StepTable()[step_index_];
+        int32_t diff = step >> 3;
+        if (code & 4) {
+            diff += step;
+        }
+        if (code & 2) {
+            diff += step >> 1;
+        }
+        if (code & 1) {
+            diff += step >> 2;
+        }
+        int32_t p   = predictor_ + ((code & 8) ? -diff : diff);
+        predictor_  = p > 32767 ? 32767 : (p < -32768 ? -32768 : p);
+        step_index_ = step_index_ + kIndex[code];
+        step_index_ = step_index_ < 0 ? 0 : (step_index_ > 88 ? 88 : step_index_);
+        return static_cast<int16_t>(predictor_);
+    }
+
+    static inline const int16_t* StepTable()
+    {
+        static const int16_t kSteps[89] = {
+            7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+            25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+            88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+            307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+            1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+            3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+            12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+        return kSteps;
+    }
+
+    static inline void Put16(uint8_t* p, uint32_t x)
+    {
+        p[0] = static_cast<uint8_t>(x);
+        p[1] = static_cast<uint8_t>(x >> 8);
+    }
+
+    static inline void Put32(uint8_t* p, uint32_t x)
+    {
+        Put16(p, x);
+        Put16(p + 2, x >> 16);
+    }
+
+    static inline void PutFloat(uint8_t* p, float x)
+    {
+        uint32_t u;
+        memcpy(&u, &x, 4);
+        Put32(p, u);
+    }
+
+    static inline uint32_t Get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static inline uint32_t Get32(const uint8_t* p) { return Get16(p) | (Get16(p + 2) << 16); }
+
+    static inline float GetFloat(const uint8_t* p)
+    {
+        uint32_t u = Get32(p);
+        float    x;
+        memcpy(&x, &u, 4);
+        return x;
+    }
+
+    Buffer*         buffer_;
+    File*           file_;
+    Mode            mode_;
+    bool            ok_;
+    Encoding        encoding_;
+    LoopBufferState state_;
+    size_t          pos_;        //samples saved or loaded
+    int32_t         predictor_;  //ADPCM state
+    int32_t         step_index_;
+    T               samples_[kChunk];
+    uint8_t         bytes_[kChunk * 4];
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,210 @@
+#pragma once
+#ifndef DSY_LOOPSTATS_H
+#define DSY_LOOPSTATS_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#if !defined(__arm__)
+#include <chrono>
+#endif
+namespace daisysp
+{
+/** Tick source for the instrumentation and for LoopBench (as LoopBenchClock).
+On the Cortex-M7 this is the DWT cycle counter, so results are in CPU cycles.
+On the host it is std::chrono::steady_clock, and results are in nanoseconds.
+Ticks are 32 bit, so a single measurement must stay below 2^32 ticks (about 4 s on the host).
+*/
+struct LoopClock
+{
+#if defined(__arm__)
+    /** enables the DWT cycle counter */
+    static void Init()
+    {
+        Reg(kDemcr) |= 1u << 24; //TRCENA
+        Reg(kDwtLar) = 0xC5ACCE55;
+        Reg(kDwtCyccnt) = 0;
+        Reg(kDwtCtrl) |= 1u;     //CYCCNTENA
+    }
+
+    static inline uint32_t Now() { return Reg(kDwtCyccnt); }
+
+    static const char* Unit() { return "cycles"; }
+
+  private:
+    static const uint32_t kDemcr      = 0xE000EDFC;
+    static const uint32_t kDwtCtrl    = 0xE0001000;
+    static const uint32_t kDwtCyccnt  = 0xE0001004;
+    static const uint32_t kDwtLar     = 0xE0001FB0;
+
+    static inline volatile uint32_t& Reg(uint32_t addr) { return *reinterpret_cast<volatile uint32_t*>(addr); }
+#else
+    static void Init() {}
+
+    static inline uint32_t Now()
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    static const char* Unit() { return "ns"; }
+#endif
+};
+
+/** Counters of one LoopBuffer, as read by the main loop with LoopBuffer::GetStats().
+Every count wraps modulo 2^32, compare two readings to get a rate.
+*/
+struct LoopStats
+{
+    uint32_t random_clips;  //random clips drawn at a clip boundary
+    uint32_t length_clamps; //SetLength()/Setlength() calls clamped to the capacity
+    uint32_t read_wraps;    //times the buffer's reads wrapped at the end of their clip or loop
+    uint32_t write_wraps;   //times the write pointer wrapped at the end of the buffer
+    uint32_t fallbacks;     //samples the block reads rendered through the per-sample path
+    uint32_t blocks;        //BeginBlock()/EndBlock() pairs timed
+    uint32_t ticks_last;    //ticks of the last timed block, in LoopClock::Unit()
+    uint32_t ticks_max;     //ticks of the slowest timed block since the last ClearStats()
+    uint32_t ticks_total;   //ticks of every timed block
+
+    LoopStats()
+    {
+        random_clips  = 0;
+        length_clamps = 0;
+        read_wraps    = 0;
+        write_wraps   = 0;
+        fallbacks     = 0;
+        blocks        = 0;
+        ticks_last    = 0;
+        ticks_max     = 0;
+        ticks_total   = 0;
+    }
+};
+
+/** Instrumentation policy that records nothing, the default of LoopBuffer.
+Every hook is empty and inlined away, and the arguments passed to them have no side effects, so a buffer
+built with it compiles to the same code as one without instrumentation.
+*/
+struct LoopStatsNone
+{
+    static const bool kEnabled = false;
+
+    inline void OnRandomClip() {}
+    inline void OnLengthClamp() {}
+    inline void OnReadWrap(bool) {}
+    inline void OnWriteWrap(bool) {}
+    inline void OnFallback() {}
+    inline void OnBlockBegin() {}
+    inline void OnBlockEnd() {}
+
+    inline bool Get(LoopStats& stats) const
+    {
+        stats = LoopStats();
+        return false;
+    }
+    inline void Clear() {}
+};
+
+/** Instrumentation policy that counts what the buffer does and times the blocks of work on it.
+Only the audio side writes the counters, each with a relaxed load and store, so counting costs a
+plain increment and never a locked read-modify-write. The main loop reads them lock-free with
+LoopBuffer::GetStats(). Each count is exact on its own, counts read together may be a block apart.
+
+Call LoopClock::Init() once at startup to enable the DWT cycle counter on the Cortex-M7.
+
+declaration example:
+
+LoopBuffer<float, SAMPLE_RATE * 10, LoopWrapCompare, LoopInterpLinear, LoopFormatNative<float>, LoopStatsCounters> loop;
+
+callback:   loop.BeginBlock(); ... loop.EndBlock();
+main loop:  LoopStats s; loop.GetStats(s);
+
+By: Shahin Etemadzadeh
+*/
+struct LoopStatsCounters
+{
+    static const bool kEnabled = true;
+
+    LoopStatsCounters() : clear_(false)
+    {
+        Zero();
+        start_ = 0;
+    }
+
+    inline void OnRandomClip() { Add(random_clips_, 1); }
+    inline void OnLengthClamp() { Add(length_clamps_, 1); }
+    inline void OnReadWrap(bool wrapped) { Add(read_wraps_, wrapped ? 1 : 0); }
+    inline void OnWriteWrap(bool wrapped) { Add(write_wraps_, wrapped ? 1 : 0); }
+    inline void OnFallback() { Add(fallbacks_, 1); }
+
+    /** audio side: starts timing a block, and applies a ClearStats() asked for since the last one */
+    inline void OnBlockBegin()
+    {
+        if (clear_.load(std::memory_order_acquire)) {
+            Zero();
+            clear_.store(false, std::memory_order_release);
+        }
+        start_ = LoopClock::Now();
+    }
+
+    inline void OnBlockEnd()
+    {
+        uint32_t ticks = LoopClock::Now() - start_;
+        ticks_last_.store(ticks, std::memory_order_relaxed);
+        if (ticks > ticks_max_.load(std::memory_order_relaxed)) {
+            ticks_max_.store(ticks, std::memory_order_relaxed);
+        }
+        Add(ticks_total_, ticks);
+        Add(blocks_, 1);
+    }
+
+    /** main loop side: copies the counters into stats */
+    bool Get(LoopStats& stats) const
+    {
+        stats.random_clips  = random_clips_.load(std::memory_order_relaxed);
+        stats.length_clamps = length_clamps_.load(std::memory_order_relaxed);
+        stats.read_wraps    = read_wraps_.load(std::memory_order_relaxed);
+        stats.write_wraps   = write_wraps_.load(std::memory_order_relaxed);
+        stats.fallbacks     = fallbacks_.load(std::memory_order_relaxed);
+        stats.blocks        = blocks_.load(std::memory_order_relaxed);
+        stats.ticks_last    = ticks_last_.load(std::memory_order_relaxed);
+        stats.ticks_max     = ticks_max_.load(std::memory_order_relaxed);
+        stats.ticks_total   = ticks_total_.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    /** main loop side: zeroes the counters at the next OnBlockBegin(), so the audio side stays the only writer */
+    inline void Clear() { clear_.store(true, std::memory_order_release); }
+
+  private:
+    static inline void Add(std::atomic<uint32_t>& counter, uint32_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void Zero()
+    {
+        random_clips_.store(0, std::memory_order_relaxed);
+        length_clamps_.store(0, std::memory_order_relaxed);
+        read_wraps_.store(0, std::memory_order_relaxed);
+        write_wraps_.store(0, std::memory_order_relaxed);
+        fallbacks_.store(0, std::memory_order_relaxed);
+        blocks_.store(0, std::memory_order_relaxed);
+        ticks_last_.store(0, std::memory_order_relaxed);
+        ticks_max_.store(0, std::memory_order_relaxed);
+        ticks_total_.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> random_clips_;
+    std::atomic<uint32_t> length_clamps_;
+    std::atomic<uint32_t> read_wraps_;
+    std::atomic<uint32_t> write_wraps_;
+    std::atomic<uint32_t> fallbacks_;
+    std::atomic<uint32_t> blocks_;
+    std::atomic<uint32_t> ticks_last_;
+    std::atomic<uint32_t> ticks_max_;
+    std::atomic<uint32_t> ticks_total_;
+    std::atomic<bool>     clear_;
+    uint32_t              start_; //LoopClock::Now() at OnBlockBegin()
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,409 @@
+#pragma once
+#ifndef DSY_LOOPSTREAM_H
+#define DSY_LOOPSTREAM_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "loopformat.h"
+#include "loopfile.h"
+namespace daisysp
+{
+/** Streams a mono loop to or from a file through a ring of RAM blocks, for loops longer than RAM
+and for keeping loops across power cycles.
+
+The audio callback only calls Write() or Read(), which copy to or from the ring and never touch the
+file. The main loop calls Service(), which flushes recorded blocks to the file and refills played
+blocks ahead of the read position. If Service() falls behind, Read() plays silence and Write()
+drops input, and both count the samples in GetUnderruns() and GetOverruns().
+
+Samples are stored in the file with the words of FormatPolicy, as a WAV file (float for the native
+float format, 16 or 24 bit PCM for LoopFormatInt16/LoopFormatInt24) or as raw words.
+
+declaration example: (4 blocks of 2048 samples, 16 bit on the card)
+
+LoopStream<float, SdFile, LoopFormatInt16, 2048, 4> stream;
+
+main loop:  stream.StartRecord(&file, 48000); ... while (recording) stream.Service(); ... stream.StopRecord();
+callback:   stream.Write(in, size);
+
+main loop:  stream.StartPlay(&file, true); ... stream.Service();
+callback:   stream.Read(out, size);
+
+Start, Stop and Service run on the main loop only. Stop recording once the callback no longer calls Write().
+
+By: Shahin Etemadzadeh
+*/
+template <typename T,
+          typename File,
+          typename FormatPolicy = LoopFormatNative<T>,
+          size_t block_samples  = 1024,
+          size_t blocks         = 4>
+class LoopStream
+{
+    static_assert(blocks >= 2, "streaming needs at least two blocks");
+
+  public:
+    typedef typename FormatPolicy::Word Word;
+
+    enum State
+    {
+        IDLE,
+        RECORDING,
+        PLAYING,
+    };
+
+    LoopStream() : state_(IDLE), position_(0), underruns_(0), overruns_(0), reset_(false) {}
+    ~LoopStream() {}
+
+    /** starts recording into a file opened for writing, with a WAV header unless wav is false.
+     *  Returns false if the header cannot be written.
+    */
+    bool StartRecord(File* file, uint32_t sampleRate, bool wav = true)
+    {
+        Stop();
+        file_  = file;
+        wav_   = wav;
+        rate_  = sampleRate;
+        start_ = wav ? kWavHeader : 0;
+        bytes_ = 0;
+        ResetRing();
+        if (wav && !WriteHeader(0)) {
+            return false;
+        }
+        state_.store(RECORDING, std::memory_order_release);
+        return true;
+    }
+
+    /** flushes the last partial block, fills in the WAV header, and stops. Returns false if a write failed.
+    */
+    bool StopRecord()
+    {
+        if (state_.load(std::memory_order_acquire) != RECORDING) {
+            return true;
+        }
+        state_.store(IDLE, std::memory_order_release);
+        bool ok = Flush();
+        if (fill_ > 0) {
+            ok &= file_->Write(ring_[WriteSlot()], fill_ * kBytesPerSample) == fill_ * kBytesPerSample;
+            bytes_ += fill_ * kBytesPerSample;
+            fill_ = 0;
+        }
+        if (wav_) {
+            ok &= WriteHeader(bytes_);
+        }
+        return ok;
+    }
+
+    /** starts playing a file, looping back to its start at the end if loop is true.
+     *  A WAV file must match the stream's format, anything else is read as raw words.
+     *  Returns false if the file holds no samples or its format does not match. The ring is filled before returning.
+    */
+    bool StartPlay(File* file, bool loop)
+    {
+        Stop();
+        file_ = file;
+        loop_ = loop;
+        if (!ParseHeader()) {
+            return false;
+        }
+        if (bytes_ < kBytesPerSample) {
+            return false;
+        }
+        ResetRing();
+        file_pos_ = 0;
+        eof_      = false;
+        file_->Seek(start_);
+        state_.store(PLAYING, std::memory_order_release);
+        Service();
+        return true;
+    }
+
+    /** stops recording or playing */
+    void Stop()
+    {
+        if (state_.load(std::memory_order_acquire) == RECORDING) {
+            StopRecord();
+        }
+        state_.store(IDLE, std::memory_order_release);
+    }
+
+    /** moves blocks between the ring and the file, call from the main loop as often as possible.
+     *  Returns false if the file could not be read or written.
+    */
+    bool Service()
+    {
+        State s = state_.load(std::memory_order_acquire);
+        if (s == RECORDING) {
+            return Flush();
+        }
+        if (s == PLAYING) {
+            return Refill();
+        }
+        return true;
+    }
+
+    /** records n samples, audio callback only. Samples that find the ring full are dropped and counted.
+    */
+    void Write(const T* in, size_t n)
+    {
+        if (state_.load(std::memory_order_acquire) != RECORDING) {
+            return;
+        }
+        ApplyReset();
+        while (n > 0) {
+            size_t w = written_.load(std::memory_order_relaxed);
+            if (w - flushed_.load(std::memory_order_acquire) >= blocks) {
+                Add(overruns_, n);
+                return;
+            }
+            size_t k = block_samples - fill_;
+            k        = k < n ? k : n;
+            FormatPolicy::StoreBlock(ring_[w % blocks], fill_, in, k);
+            fill_ += k;
+            in += k;
+            n -= k;
+            if (fill_ == block_samples) {
+                counts_[w % blocks] = block_samples;
+                fill_               = 0;
+                written_.store(w + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    /** plays n samples, audio callback only. Samples the ring does not hold yet are silent and counted,
+     *  the end of a file that does not loop is silent without counting.
+    */
+    void Read(T* out, size_t n)
+    {
+        if (state_.load(std::memory_order_acquire) != PLAYING) {
+            memset(out, 0, n * sizeof(T));
+            return;
+        }
+        ApplyReset();
+        while (n > 0) {
+            size_t r = flushed_.load(std::memory_order_relaxed);
+            if (r == written_.load(std::memory_order_acquire)) {
+                if (!eof_.load(std::memory_order_acquire)) {
+                    Add(underruns_, n);
+                }
+                memset(out, 0, n * sizeof(T));
+                return;
+            }
+            size_t count = counts_[r % blocks];
+            size_t k     = count - fill_;
+            k            = k < n ? k : n;
+            FormatPolicy::LoadBlock(ring_[r % blocks], fill_, out, k);
+            fill_ += k;
+            out += k;
+            n -= k;
+            Add(position_, k);
+            if (fill_ == count) {
+                fill_ = 0;
+                flushed_.store(r + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    inline State GetState() const { return state_.load(std::memory_order_acquire); }
+
+    /** returns the number of samples played since StartPlay() */
+    inline size_t GetPosition() const { return position_.load(std::memory_order_relaxed); }
+
+    /** returns the number of samples recorded to the file so far, or held by the file being played */
+    inline size_t GetLength() const { return bytes_ / kBytesPerSample; }
+
+    /** returns the number of samples played as silence because the ring ran dry */
+    inline uint32_t GetUnderruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+    /** returns the number of recorded samples dropped because the ring was full */
+    inline uint32_t GetOverruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+    /** main loop side: zeroes the underrun and overrun counts at the next Read() or Write(), so the
+     *  audio side stays the only writer of the counters while a stream runs
+    */
+    inline void ResetCounters() { reset_.store(true, std::memory_order_release); }
+
+  private:
+    static const size_t kBytesPerSample = FormatPolicy::kWordsPerSample * sizeof(Word);
+    static const size_t kBlockWords     = block_samples * FormatPolicy::kWordsPerSample;
+    static const size_t kBlockBytes     = block_samples * kBytesPerSample;
+    static const size_t kWavHeader      = 44;
+
+    inline void ResetRing()
+    {
+        written_.store(0, std::memory_order_relaxed);
+        flushed_.store(0, std::memory_order_relaxed);
+        fill_ = 0;
+        //the stream is idle, so the callback does not touch the counters meanwhile
+        position_.store(0, std::memory_order_relaxed);
+        underruns_.store(0, std::memory_order_relaxed);
+        overruns_.store(0, std::memory_order_relaxed);
+        reset_.store(false, std::memory_order_relaxed);
+    }
+
+    /** audio side: applies a ResetCounters() asked for since the last Read() or Write() */
+    inline void ApplyReset()
+    {
+        if (reset_.load(std::memory_order_acquire)) {
+            underruns_.store(0, std::memory_order_relaxed);
+            overruns_.store(0, std::memory_order_relaxed);
+            reset_.store(false, std::memory_order_release);
+        }
+    }
+
+    //audio side only, so a plain load and store
+    template <typename U>
+    static inline void Add(std::atomic<U>& counter, size_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + static_cast<U>(n), std::memory_order_relaxed);
+    }
+
+    inline size_t WriteSlot() const { return written_.load(std::memory_order_relaxed) % blocks; }
+
+    /** writes every full recorded block to the file */
+    bool Flush()
+    {
+        bool ok = true;
+        while (flushed_.load(std::memory_order_relaxed) != written_.load(std::memory_order_acquire)) {
+            size_t f = flushed_.load(std::memory_order_relaxed);
+            ok &= file_->Write(ring_[f % blocks], kBlockBytes) == kBlockBytes;
+            bytes_ += kBlockBytes;
+            flushed_.store(f + 1, std::memory_order_release);
+        }
+        return ok;
+    }
+
+    /** reads blocks from the file into every free slot of the ring */
+    bool Refill()
+    {
+        bool ok = true;
+        while (!eof_.load(std::memory_order_relaxed)
+               && written_.load(std::memory_order_relaxed) - flushed_.load(std::memory_order_acquire) < blocks) {
+            size_t w     = written_.load(std::memory_order_relaxed);
+            uint8_t* dst = reinterpret_cast<uint8_t*>(ring_[w % blocks]);
+            size_t got   = 0;
+            while (got < kBlockBytes) {
+                size_t k = bytes_ - file_pos_;
+                k        = k < kBlockBytes - got ? k : kBlockBytes - got;
+                k -= k % kBytesPerSample;
+                if (k == 0) {
+                    if (!loop_) {
+                        break;
+                    }
+                    //wrap the loop around inside the block
+                    file_pos_ = 0;
+                    ok &= file_->Seek(start_);
+                    continue;
+                }
+                size_t n = file_->Read(dst + got, k);
+                got += n;
+                file_pos_ += n;
+                if (n < k) {
+                    ok = false;
+                    break;
+                }
+            }
+            counts_[w % blocks] = got / kBytesPerSample;
+            if (got < kBlockBytes) {
+                eof_.store(true, std::memory_order_release);
+            }
+            if (counts_[w % blocks] > 0) {
+                written_.store(w + 1, std::memory_order_release);
+            }
+        }
+        return ok;
+    }
+
+    static inline void Put16(uint8_t* p, uint32_t x)
+    {
+        p[0] = static_cast<uint8_t>(x);
+        p[1] = static_cast<uint8_t>(x >> 8);
+    }
+
+    static inline void Put32(uint8_t* p, uint32_t x)
+    {
+        Put16(p, x);
+        Put16(p + 2, x >> 16);
+    }
+
+    static inline uint32_t Get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static inline uint32_t Get32(const uint8_t* p) { return Get16(p) | (Get16(p + 2) << 16); }
+
+    /** writes the 44 byte header of a mono WAV file holding dataBytes bytes of samples at the file start */
+    bool WriteHeader(size_t dataBytes)
+    {
+        uint8_t h[kWavHeader];
+        memcpy(h, "RIFF", 4);
+        Put32(h + 4, static_cast<uint32_t>(36 + dataBytes));
+        memcpy(h + 8, "WAVEfmt ", 8);
+        Put32(h + 16, 16);
+        Put16(h + 20, FormatPolicy::kWavFormat);
+        Put16(h + 22, 1);
+        Put32(h + 24, rate_);
+        Put32(h + 28, static_cast<uint32_t>(rate_ * kBytesPerSample));
+        Put16(h + 32, static_cast<uint32_t>(kBytesPerSample));
+        Put16(h + 34, static_cast<uint32_t>(kBytesPerSample * 8));
+        memcpy(h + 36, "data", 4);
+        Put32(h + 40, static_cast<uint32_t>(dataBytes));
+        bool ok = file_->Seek(0) && file_->Write(h, kWavHeader) == kWavHeader;
+        return file_->Seek(kWavHeader + dataBytes) && ok;
+    }
+
+    /** finds the samples in a WAV file, or takes the whole file as raw words when it is not one */
+    bool ParseHeader()
+    {
+        size_t  size = file_->Size();
+        uint8_t h[16];
+        start_ = 0;
+        bytes_ = size;
+        rate_  = 0;
+        if (!file_->Seek(0) || file_->Read(h, 12) < 12 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) {
+            return true;
+        }
+        size_t pos = 12;
+        while (pos + 8 <= size) {
+            file_->Seek(pos);
+            if (file_->Read(h, 8) < 8) {
+                return false;
+            }
+            size_t chunk = Get32(h + 4);
+            if (memcmp(h, "fmt ", 4) == 0) {
+                if (chunk < 16 || file_->Read(h, 16) < 16) {
+                    return false;
+                }
+                if (Get16(h) != FormatPolicy::kWavFormat || Get16(h + 2) != 1 || Get16(h + 14) != kBytesPerSample * 8) {
+                    return false;
+                }
+                rate_ = Get32(h + 4);
+            } else if (memcmp(h, "data", 4) == 0) {
+                start_ = pos + 8;
+                bytes_ = chunk < size - start_ ? chunk : size - start_;
+                return rate_ != 0;
+            }
+            pos += 8 + chunk + (chunk & 1);
+        }
+        return false;
+    }
+
+    std::atomic<State>    state_;
+    std::atomic<size_t>   written_; //blocks handed over by the producer
+    std::atomic<size_t>   flushed_; //blocks taken by the consumer
+    std::atomic<bool>     eof_;
+    File*                 file_;
+    bool                  wav_;
+    bool                  loop_;
+    uint32_t              rate_;
+    size_t                start_;     //offset of the first sample in the file
+    size_t                bytes_;     //bytes of samples in the file
+    size_t                file_pos_;  //bytes of samples read so far in this pass
+    size_t                fill_;      //samples used of the block the callback is on
+    std::atomic<size_t>   position_;  //samples played, written by the callback only
+    std::atomic<uint32_t> underruns_; //written by the callback only
+    std::atomic<uint32_t> overruns_;  //written by the callback only
+    std::atomic<bool>     reset_;     //ResetCounters() asked for, applied by the callback
+    size_t                counts_[blocks];
+    Word                  ring_[blocks][kBlockWords];
+};
+} // namespace daisysp
+#endif
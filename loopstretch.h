@@ -0,0 +1,273 @@
+#pragma once
+#ifndef DSY_LOOPSTRETCH_H
+#define DSY_LOOPSTRETCH_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Time-stretch playback of a LoopBuffer, with tempo and pitch set independently.
+ReadSpeed() moves through the loop at the rate it plays it back, so a faster loop is also higher. Here
+two read heads play overlapping grains of the loop at the pitch speed, while the position new grains
+start from moves at the tempo speed. Each grain lasts one window and starts half a window after the
+previous one. The incoming grain fades in as the outgoing one fades out (sin^2 and cos^2, which sum to
+1), so with tempo and pitch both at 1 the output is the loop itself.
+
+With a search range set (WSOLA), each new grain is moved by up to that many samples to where it best
+matches what the outgoing grain would have played next, so the two line up in phase under the fade
+instead of beating. The search compares a fixed number of decimated taps at a fixed number of offsets,
+once per grain, so its cost does not depend on the settings.
+
+Every sample costs two fixed-point reads (LoopBuffer::ReadPhaseBlock()), a rotation for the window and a mix,
+whatever the tempo and pitch.
+
+To follow an external clock, FitLength() sets the tempo so that one pass of the loop takes a given
+number of samples, for instance one bar at the clock's tempo.
+
+declaration example:
+
+LoopBuffer<float, SAMPLE_RATE * 10> DSY_SDRAM_BSS loop;
+LoopStretch<LoopBuffer<float, SAMPLE_RATE * 10>> stretch;
+
+stretch.Init(&loop, 2048);
+stretch.SetSearch(256);
+stretch.FitLength(barLength);   //the loop lasts one bar of the incoming clock, at its recorded pitch
+...
+stretch.ProcessBlock(out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer>
+class LoopStretch
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    static const size_t kMinWindow = 256;
+
+    LoopStretch() {}
+    ~LoopStretch() {}
+
+    /** attaches the stretcher to a buffer, at the start of the loop with tempo and pitch 1
+     *  size_t window - grain length in samples, at least kMinWindow. Longer windows smear
+     *                  transients less often but more audibly, 1024 to 4096 suits most loops at 48kHz.
+    */
+    void Init(Buffer* buffer, size_t window = 2048)
+    {
+        buffer_    = buffer;
+        window     = window > kMinWindow ? window : kMinWindow;
+        hop_       = window / 2;
+        rot_cos_   = cosf(kPi / static_cast<float>(hop_));
+        rot_sin_   = sinf(kPi / static_cast<float>(hop_));
+        tempo_     = 1.f;
+        search_    = 0;
+        src_       = 0;
+        src_frac_  = 0.f;
+        in_        = 0;
+        for (size_t g = 0; g < 2; g++) {
+            head_[g].Reset();
+        }
+        SetPitch(1.f);
+        //the first sample starts a grain
+        age_ = hop_;
+    }
+
+    /** sets how fast the loop's timeline moves, 1.0 is the recorded tempo, 0 freezes it on one spot.
+     *  Negative values move backwards through the loop while the grains still play forwards.
+    */
+    inline void SetTempo(float tempo) { tempo_ = tempo; }
+
+    /** sets the tempo so that one pass of the loop takes samples samples, at the recorded pitch */
+    inline void FitLength(size_t samples)
+    {
+        if (samples > 0) {
+            tempo_ = static_cast<float>(buffer_->GetLoopLength()) / static_cast<float>(samples);
+        }
+    }
+
+    /** sets the playback speed of the grains, as a ratio, 2.0 is an octave up. Negative plays them reversed.
+     *  Takes effect at once on both heads.
+    */
+    inline void SetPitch(float pitch)
+    {
+        for (size_t g = 0; g < 2; g++) {
+            buffer_->SetPhaseSpeed(head_[g], pitch);
+        }
+        //the grain compares taps along its own direction and speed
+        for (size_t j = 0; j < kTaps; j++) {
+            tap_[j] = static_cast<int32_t>(pitch * static_cast<float>(j * kTapStride));
+        }
+    }
+
+    /** sets how far in samples each new grain may move to line up with the outgoing one, at most a
+     *  quarter window. 0 places grains exactly where the tempo puts them (plain overlap-add).
+    */
+    inline void SetSearch(size_t samples) { search_ = samples < hop_ / 2 ? samples : hop_ / 2; }
+
+    /** moves the timeline to position, in samples. The next sample starts a grain there and the
+     *  current one fades out, so the jump is crossfaded.
+    */
+    inline void SetPosition(size_t position)
+    {
+        size_t length = buffer_->GetLoopLength();
+        src_          = length > 0 ? position % length : 0;
+        src_frac_     = 0.f;
+        age_          = hop_;
+    }
+
+    /** returns the position of the timeline in the loop, in samples */
+    inline size_t GetPosition() const { return src_; }
+
+    /** renders n samples into out */
+    void ProcessBlock(T* out, size_t n)
+    {
+        size_t length = buffer_->GetLoopLength();
+        if (length <= 1) {
+            LoopKernelClear(out, n);
+            return;
+        }
+        //the loop may have been shortened since the last block
+        src_ = src_ < length ? src_ : src_ % length;
+        for (size_t g = 0; g < 2; g++) {
+            if (head_[g].read_ptr >= length) {
+                buffer_->SetReadPosition(head_[g], head_[g].read_ptr % length);
+            }
+        }
+        size_t i = 0;
+        while (i < n) {
+            if (age_ >= hop_) {
+                StartGrain(length);
+            }
+            size_t k = hop_ - age_;
+            k        = k < n - i ? k : n - i;
+            k        = k < kChunk ? k : kChunk;
+            T a[kChunk], b[kChunk];
+            buffer_->ReadPhaseBlock(head_[in_], a, k);
+            buffer_->ReadPhaseBlock(head_[1 - in_], b, k);
+            //incoming gain sin^2(pi/2 t) = (1 - cos(pi t)) / 2, outgoing 1 minus that, t = age_ / hop_.
+            //cos(pi t) comes from rotating (cos, sin) by pi / hop_ per sample, restarted with every grain.
+            float c = cos_;
+            float s = sin_;
+            for (size_t j = 0; j < k; j++) {
+                out[i + j] = b[j] + (a[j] - b[j]) * (0.5f - 0.5f * c);
+                float cn   = c * rot_cos_ - s * rot_sin_;
+                s          = s * rot_cos_ + c * rot_sin_;
+                c          = cn;
+            }
+            cos_ = c;
+            sin_ = s;
+            age_ += k;
+            i += k;
+            Advance(k, length);
+        }
+    }
+
+  private:
+    static const size_t kChunk      = 64;
+    static const size_t kTaps       = 32; //taps compared per candidate offset
+    static const size_t kTapStride  = 4;  //samples between taps, so the taps span 128 samples at pitch 1
+    static const size_t kCandidates = 16; //offsets on the coarse search grid
+    static constexpr float kPi      = 3.14159265358979f;
+
+    /** moves the timeline k output samples on */
+    inline void Advance(size_t k, size_t length)
+    {
+        float   x     = src_frac_ + tempo_ * static_cast<float>(k);
+        float   fl    = floorf(x);
+        src_frac_     = x - fl;
+        src_          = LoopAdvance(src_, static_cast<int32_t>(fl), length);
+    }
+
+    /** restarts the head that has faded out as the new grain, at the timeline position */
+    void StartGrain(size_t length)
+    {
+        in_           = 1 - in_;
+        LoopHead& g   = head_[in_];
+        size_t start  = search_ > 0 ? Align(head_[1 - in_], length) : src_;
+        buffer_->SetReadPosition(g, start);
+        g.phase       = static_cast<uint32_t>(static_cast<double>(src_frac_) * 4294967296.0);
+        g.frac        = src_frac_;
+        age_          = 0;
+        cos_          = 1.f;
+        sin_          = 0.f;
+    }
+
+    /** returns the grain start within search_ of the timeline that best matches what the outgoing head x
+     *  plays next: the largest normalized correlation over the taps, found on a coarse grid and then
+     *  refined by halving the step down to one sample
+    */
+    size_t Align(const LoopHead& x, size_t length)
+    {
+        float ref[kTaps];
+        for (size_t j = 0; j < kTaps; j++) {
+            ref[j] = static_cast<float>(Tap(x.read_ptr, tap_[j], length));
+        }
+        const int32_t range = static_cast<int32_t>(search_);
+        int32_t       grid  = (2 * range) / static_cast<int32_t>(kCandidates - 1);
+        grid                = grid > 0 ? grid : 1;
+        int32_t best        = 0;
+        float   score       = Score(ref, 0, length);
+        for (int32_t d = -range; d <= range; d += grid) {
+            float s = Score(ref, d, length);
+            if (s > score) {
+                score = s;
+                best  = d;
+            }
+        }
+        for (int32_t step = grid / 2; step > 0; step /= 2) {
+            int32_t centre = best;
+            for (int32_t d = centre - step; d <= centre + step; d += 2 * step) {
+                if (d < -range || d > range) {
+                    continue;
+                }
+                float s = Score(ref, d, length);
+                if (s > score) {
+                    score = s;
+                    best  = d;
+                }
+            }
+        }
+        return LoopAdvance(src_, best, length);
+    }
+
+    /** correlation of the grain starting d samples from the timeline with ref, normalized by the
+     *  grain's energy and kept signed, so louder spans are not favoured and opposite phase loses
+    */
+    inline float Score(const float* ref, int32_t d, size_t length) const
+    {
+        size_t p   = LoopAdvance(src_, d, length);
+        float  dot = 0.f;
+        float  e   = 1e-9f;
+        for (size_t j = 0; j < kTaps; j++) {
+            float v = static_cast<float>(Tap(p, tap_[j], length));
+            dot += v * ref[j];
+            e += v * v;
+        }
+        return dot * fabsf(dot) / e;
+    }
+
+    inline T Tap(size_t position, int32_t offset, size_t length) const
+    {
+        T v;
+        buffer_->Peek(LoopAdvance(position, offset, length), &v, 1);
+        return v;
+    }
+
+    Buffer*  buffer_;
+    LoopHead head_[2];     //the two grains, head_[in_] is fading in
+    size_t   in_;
+    size_t   hop_;         //half a window, the spacing of the grains
+    float    rot_cos_;     //cos and sin of pi / hop_, the window phase advance per sample
+    float    rot_sin_;
+    float    cos_;         //cos and sin of the window phase at age_
+    float    sin_;
+    size_t   age_;         //samples since the current grain started, a new one starts at hop_
+    float    tempo_;
+    size_t   search_;      //how far a grain may move to line up, 0 for plain overlap-add
+    size_t   src_;         //timeline position in the loop, where the next grain starts
+    float    src_frac_;
+    int32_t  tap_[kTaps];  //offsets of the compared taps, along the grain's speed
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,251 @@
+#pragma once
+#ifndef DSY_MULTILOOP_H
+#define DSY_MULTILOOP_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Interleaved multichannel loop buffer.
+Frames of channels samples are stored next to each other and share one write pointer,
+one read pointer and one length, so a stereo or quad loop does its position bookkeeping
+once per frame and reads each frame in a single burst.
+
+Semantics match LoopBuffer: Write() grows the loop as it records, Read() loops over it.
+
+declaration example: (10 seconds of stereo floats)
+
+MultiLoopBuffer<float, 2, SAMPLE_RATE * 10> DSY_SDRAM_BSS loop;
+
+By: Shahin Etemadzadeh
+*/
+template <typename T, size_t channels, size_t max_frames, typename WrapPolicy = LoopWrapCompare>
+class MultiLoopBuffer
+{
+    static_assert(!WrapPolicy::kPowerOfTwo || (max_frames & (max_frames - 1)) == 0,
+                  "LoopWrapMask requires a power of two max_frames");
+
+  public:
+    typedef T SampleType;
+
+    MultiLoopBuffer() {}
+    ~MultiLoopBuffer() {}
+
+    /** initializes the buffer by clearing the values within, and setting length to 1 frame.
+    */
+    void Init()
+    {
+        memset(line_, 0, sizeof(line_));
+        Reset();
+    }
+
+    /** sets write ptr and read ptr to 0, and length to 1 frame.
+    */
+    void Reset()
+    {
+        write_ptr_ = 0;
+        read_ptr_  = 0;
+        length_    = 1;
+        frac_      = 0.f;
+    }
+
+    /** sets the loop length in frames
+    */
+    inline void SetLength(size_t length)
+    {
+        length_ = length < max_frames ? length : max_frames;
+        length_ = length_ > 0 ? length_ : 1;
+        read_ptr_ %= length_;
+    }
+
+    /** returns the loop length in frames
+    */
+    inline size_t GetLength() const { return length_; }
+
+    /** sets the read pointer position in frames, bounded on the loop
+    */
+    inline void SetReadPosition(size_t position)
+    {
+        read_ptr_ = position < length_ ? position : length_ - 1;
+        frac_     = 0.f;
+    }
+
+    /** returns the position of the read pointer in frames
+    */
+    inline size_t GetReadPosition() const { return read_ptr_; }
+
+    /** returns the position of the write pointer in frames
+    */
+    inline size_t GetWritePosition() const { return write_ptr_; }
+
+    /** writes one frame of channels samples, and advances the write ptr while dynamically updating the length
+    */
+    inline void Write(const T* frame)
+    {
+        T* dst = &line_[write_ptr_ * channels];
+        for (size_t c = 0; c < channels; c++) {
+            dst[c] = frame[c];
+        }
+        write_ptr_ = WrapPolicy::WrapBuffer(write_ptr_ + 1, max_frames);
+        if (write_ptr_ >= length_) {
+            length_ = write_ptr_ + 1;
+        }
+    }
+
+    /** reads the next frame into frame, and increments the read pointer
+    */
+    inline void Read(T* frame)
+    {
+        const T* src = &line_[read_ptr_ * channels];
+        for (size_t c = 0; c < channels; c++) {
+            frame[c] = src[c];
+        }
+        read_ptr_ = WrapPolicy::Wrap(read_ptr_ + 1, length_);
+    }
+
+    /** advances the read pointer at a variable speed and reads the next frame, linearly interpolated, into frame.
+     *  Negative speeds play in reverse.
+    */
+    inline void ReadSpeed(T* frame, float speed)
+    {
+        float   s    = speed + frac_;
+        int32_t step = static_cast<int32_t>(s);
+        step -= (s < static_cast<float>(step));
+        read_ptr_ = LoopAdvance(read_ptr_, step, length_);
+        frac_     = s - step;
+
+        const T* a = &line_[read_ptr_ * channels];
+        const T* b = &line_[WrapPolicy::Wrap(read_ptr_ + 1, length_) * channels];
+        for (size_t c = 0; c < channels; c++) {
+            frame[c] = a[c] + (b[c] - a[c]) * frac_;
+        }
+    }
+
+    /** writes n interleaved frames, equivalent to n calls to Write().
+     *  The copy is split at the end of the buffer into at most two contiguous spans.
+    */
+    inline void WriteBlock(const T* in, size_t frames)
+    {
+        while (frames > 0) {
+            size_t k = max_frames - write_ptr_;
+            k = k < frames ? k : frames;
+            T* dst = &line_[write_ptr_ * channels];
+            for (size_t i = 0; i < k * channels; i++) {
+                dst[i] = in[i];
+            }
+            GrowTo(k);
+            in += k * channels;
+            frames -= k;
+        }
+    }
+
+    /** writes n frames from one buffer per channel, as passed to the audio callback
+    */
+    inline void WriteBlock(const T* const* in, size_t frames)
+    {
+        size_t done = 0;
+        while (done < frames) {
+            size_t k = max_frames - write_ptr_;
+            k = k < (frames - done) ? k : (frames - done);
+            T* dst = &line_[write_ptr_ * channels];
+            for (size_t i = 0; i < k; i++) {
+                for (size_t c = 0; c < channels; c++) {
+                    dst[i * channels + c] = in[c][done + i];
+                }
+            }
+            GrowTo(k);
+            done += k;
+        }
+    }
+
+    /** reads n interleaved frames into out, equivalent to n calls to Read().
+    */
+    inline void ReadBlock(T* out, size_t frames)
+    {
+        read_ptr_ = read_ptr_ < length_ ? read_ptr_ : 0;
+        while (frames > 0) {
+            size_t k = length_ - read_ptr_;
+            k = k < frames ? k : frames;
+            const T* src = &line_[read_ptr_ * channels];
+            for (size_t i = 0; i < k * channels; i++) {
+                out[i] = src[i];
+            }
+            read_ptr_ = read_ptr_ + k < length_ ? read_ptr_ + k : 0;
+            out += k * channels;
+            frames -= k;
+        }
+    }
+
+    /** reads n frames into one buffer per channel, as passed to the audio callback
+    */
+    inline void ReadBlock(T* const* out, size_t frames)
+    {
+        read_ptr_ = read_ptr_ < length_ ? read_ptr_ : 0;
+        size_t done = 0;
+        while (done < frames) {
+            size_t k = length_ - read_ptr_;
+            k = k < (frames - done) ? k : (frames - done);
+            const T* src = &line_[read_ptr_ * channels];
+            for (size_t i = 0; i < k; i++) {
+                for (size_t c = 0; c < channels; c++) {
+                    out[c][done + i] = src[i * channels + c];
+                }
+            }
+            read_ptr_ = read_ptr_ + k < length_ ? read_ptr_ + k : 0;
+            done += k;
+        }
+    }
+
+    /** reads n interleaved frames into out, equivalent to n calls to ReadSpeed(speed).
+    */
+    inline void ReadSpeedBlock(T* out, size_t frames, float speed)
+    {
+        size_t maxStep = speed >= 0.f ? (size_t) speed + 1 : 1;
+        size_t i       = 0;
+        while (i < frames) {
+            //steps that keep both interpolation frames inside the loop
+            size_t k = 0;
+            if (speed >= 0.f && read_ptr_ + 1 < length_) {
+                k = ((length_ - 2) - read_ptr_) / maxStep;
+                k = k < (frames - i) ? k : (frames - i);
+            }
+            if (k == 0) {
+                ReadSpeed(&out[i * channels], speed);
+                i++;
+                continue;
+            }
+            for (size_t j = 0; j < k; j++, i++) {
+                float   s    = speed + frac_;
+                int32_t step = static_cast<int32_t>(s);
+                read_ptr_ += step;
+                frac_ = s - step;
+                const T* a = &line_[read_ptr_ * channels];
+                const T* b = a + channels;
+                for (size_t c = 0; c < channels; c++) {
+                    out[i * channels + c] = a[c] + (b[c] - a[c]) * frac_;
+                }
+            }
+        }
+    }
+
+  private:
+    /** advances the write pointer after k frames were stored, growing the loop like Write()
+    */
+    inline void GrowTo(size_t k)
+    {
+        size_t hi = write_ptr_ + k < max_frames ? write_ptr_ + k : max_frames - 1;
+        if (hi > write_ptr_ && hi >= length_) {
+            length_ = hi + 1;
+        }
+        write_ptr_ = WrapPolicy::WrapBuffer(write_ptr_ + k, max_frames);
+    }
+
+    float  frac_;
+    size_t write_ptr_;
+    size_t read_ptr_;
+    size_t length_;
+    T      line_[max_frames * channels];
+};
+} // namespace daisysp
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef DSY_PLAYHEAD_H
+#define DSY_PLAYHEAD_H
+#include <stdlib.h>
+#include <stdint.h>
+#include "loopbuffer.h"
+namespace daisysp
+{
+/** Independent playback position over a shared LoopBuffer.
+Each PlayHead carries its own position, fraction, speed and clip window, so several voices
+can play the same recorded loop without keeping a copy of the audio per voice.
+
+declaration example: (4 voices over one buffer)
+
+LoopBuffer<float, SAMPLE_RATE * 10> DSY_SDRAM_BSS loop;
+PlayHead<LoopBuffer<float, SAMPLE_RATE * 10>> heads[4];
+
+heads[i].Init(&loop);
+...
+PlayHead<LoopBuffer<float, SAMPLE_RATE * 10>>::MixBlock(heads, 4, out, size);
+
+By: Shahin Etemadzadeh
+*/
+template <typename Buffer>
+class PlayHead
+{
+  public:
+    typedef typename Buffer::SampleType T;
+
+    PlayHead() {}
+    ~PlayHead() {}
+
+    /** attaches the head to a buffer and resets it to play the whole loop at normal speed.
+    */
+    void Init(Buffer* buffer)
+    {
+        buffer_     = buffer;
+        speed_      = 1.f;
+        gain_       = 1.f;
+        rand_len_   = false;
+        rand_start_ = false;
+        head_.Reset();
+        buffer_->SetClipSmoothing(head_, 1.f);
+        buffer_->SetClip(head_, 0.f, 1.f, 1);
+    }
+
+    /** sets the playback speed, 1.0 is normal speed, negative values play in reverse
+    */
+    inline void SetSpeed(float speed) { speed_ = speed; }
+
+    /** sets how many samples the head takes to glide to a new speed, 0 jumps at once
+    */
+    inline void SetSpeedRamp(size_t length) { head_.SetSpeedRamp(length); }
+
+    /** sets the clip window played by this head
+     *  float start - [0..1.0] where in the loop the clip starts
+     *  float end   - [0..1.0] how long the clip is, as a fraction of the loop
+     *  size_t minClip - size in samples of the shortest allowable clip
+    */
+    inline void SetClip(float start, float end, size_t minClip)
+    {
+        buffer_->SetClip(head_, start, end, minClip > 0 ? minClip : 1);
+    }
+
+    /** sets how quickly the clip window glides to a new SetClip(), the fraction (0..1.0] of the way
+     *  covered per ProcessBlock(), see LoopBuffer::SetClipSmoothing(). 1 jumps.
+    */
+    inline void SetClipSmoothing(float smooth) { buffer_->SetClipSmoothing(head_, smooth); }
+
+    /** randomizes the clip length and/or start point each time the clip wraps
+    */
+    inline void SetRandom(bool randomLength, bool randomStart)
+    {
+        rand_len_   = randomLength;
+        rand_start_ = randomStart;
+    }
+
+    /** sets the length in samples of the equal-power crossfade played each time the clip wraps, 0 disables it
+    */
+    inline void SetCrossfade(size_t length) { head_.SetCrossfade(length); }
+
+    /** sets the gain applied by MixBlock
+    */
+    inline void SetGain(float gain) { gain_ = gain; }
+
+    /** moves the head to a position within the clip, in samples
+    */
+    inline void SetPosition(size_t position) { buffer_->SetReadPosition(head_, position); }
+
+    /** returns the position of the head within the clip
+    */
+    inline size_t GetPosition() const { return head_.read_ptr; }
+
+    /** returns the read state of this head
+    */
+    inline LoopHead& GetHead() { return head_; }
+
+    /** returns the next sample of the clip, interpolated, and advances the head
+    */
+    inline const T Process()
+    {
+        const LoopClip& c = head_.clip;
+        head_.glide.Set(speed_);
+        return buffer_->Read(head_, c.start_now, c.end_now, head_.glide.Next(), c.min, rand_len_, rand_start_);
+    }
+
+    /** renders n samples of this head into out, moving the clip window one step towards its target first
+    */
+    inline void ProcessBlock(T* out, size_t n)
+    {
+        buffer_->UpdateClip(head_);
+        Render(out, n);
+    }
+
+    /** renders count heads and sums them into out, scaled by each head's gain.
+     *  The heads are advanced together in short chunks, so heads playing near the same position
+     *  reuse the cache lines the previous head just fetched instead of each streaming the whole block.
+    */
+    static void MixBlock(PlayHead* heads, size_t count, T* out, size_t n)
+    {
+        T tmp[kMixChunk];
+        for (size_t h = 0; h < count; h++) {
+            heads[h].buffer_->UpdateClip(heads[h].head_);
+        }
+        while (n > 0) {
+            size_t k = n < kMixChunk ? n : size_t(kMixChunk);
+            LoopKernelClear(out, k);
+            for (size_t h = 0; h < count; h++) {
+                heads[h].Render(tmp, k);
+                LoopKernelMix(out, tmp, k, heads[h].gain_);
+            }
+            out += k;
+            n -= k;
+        }
+    }
+
+  private:
+    static const size_t kMixChunk = 16;
+
+    inline void Render(T* out, size_t n)
+    {
+        const LoopClip& c = head_.clip;
+        buffer_->ReadBlock(head_, out, n, c.start_now, c.end_now, speed_, c.min, rand_len_, rand_start_);
+    }
+
+    Buffer*  buffer_;
+    LoopHead head_;
+    float    speed_;
+    float    gain_;
+    bool     rand_len_;
+    bool     rand_start_;
+};
+} // namespace daisysp
+#endif
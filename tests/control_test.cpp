@@ -0,0 +1,82 @@
+/** Host regression test of the checks LoopControl::Apply() makes on values queued from the main loop.
+A length from a knob at 0, or a splice that does not fit the loop, must never reach the buffer unchecked:
+the audio side would divide by zero, stall, or fade past the storage.
+*/
+#include <math.h>
+#include "looptest.h"
+#include "loopcontrol.h"
+
+using namespace daisysp;
+
+static const size_t kSampleRate = 4800;
+
+typedef LoopBuffer<float, kSampleRate * 60> Buffer;
+
+static Buffer              loop;
+static LoopControl<Buffer> control;
+
+//one audio callback, as in the example of LoopControl
+static void Callback()
+{
+    float in[48], out[48];
+    for (size_t i = 0; i < 48; i++) {
+        in[i] = 0.25f;
+    }
+    control.Apply();
+    loop.ReadBlock(out, 48);
+    loop.ReadSpeedBlock(out, 48, 1.5f);
+    loop.Overdub(in, 48, 0.9f, 0.5f);
+}
+
+int main()
+{
+    loop.Init();
+    control.Init(&loop);
+    Callback();
+
+    //the knob at 0
+    float knob = 0.f;
+    LOOP_CHECK(control.SetLength(static_cast<size_t>(knob * kSampleRate * 60)));
+    Callback();
+    LOOP_CHECK(loop.GetLoopLength() == 1);
+
+    LOOP_CHECK(control.Setlength(knob * kSampleRate * 60));
+    Callback();
+    LOOP_CHECK(loop.GetLoopLength() == 1);
+
+    //below 1, negative, NaN and past the capacity
+    const float lengths[] = {0.5f, -3.f, NAN, 1e12f};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        control.Setlength(lengths[i]);
+        Callback();
+        LOOP_CHECK(loop.GetLoopLength() >= 1 && loop.GetLoopLength() <= loop.GetCapacity());
+    }
+
+    //a sweep of the knob, every length is applied between two callbacks
+    for (int k = 0; k <= 100; k++) {
+        control.SetLength(static_cast<size_t>(k * 0.01f * kSampleRate * 60));
+        Callback();
+        LOOP_CHECK(loop.GetLoopLength() >= 1);
+    }
+
+    //splices that do not fit the loop are refused and counted
+    control.SetLength(1000);
+    control.Splice(100, 950, 999); //the fade in runs past the end of the loop
+    control.Splice(100, 600, 400); //the start after the end
+    control.Splice(100, 0, 5000);  //the end past the loop
+    control.Splice();              //a 1000 sample loop is too short for the fades of Splice()
+    Callback();
+    LOOP_CHECK(control.GetRejected() == 4);
+    LOOP_CHECK(!loop.IsSplicing());
+
+    //a splice that fits runs to the end over the following callbacks
+    control.Splice(100, 0, 999);
+    for (int i = 0; i < 10; i++) {
+        Callback();
+    }
+    LOOP_CHECK(control.GetRejected() == 4);
+    LOOP_CHECK(!loop.IsSplicing());
+    LOOP_CHECK(control.GetDropped() == 0);
+
+    return LoopTestResult("control_test");
+}
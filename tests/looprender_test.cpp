@@ -0,0 +1,96 @@
+/** Host regression test of LoopBuffer through LoopRender.
+Checks that the block APIs render DefaultScript() bit for bit like the per-sample API at several block
+sizes, and that a short script still renders bit for bit like golden/looprender.wav, in both modes.
+Prints the throughput of each run. Returns nonzero on any mismatch.
+
+usage:  looprender_test [--update] [golden.wav]
+        --update rewrites the golden file from the per-sample render, after a change of output is intended
+*/
+#include <stdio.h>
+#include <string.h>
+#include "looprender.h"
+
+using namespace daisysp;
+
+typedef LoopBuffer<float, 48000 * 4> Buffer;
+
+static Buffer loop;
+static float  scratch[1 << 19];
+
+//the modes of DefaultScript() on a 9600 sample loop, short enough to keep its golden file small
+static const LoopRenderStep golden_script[] = {
+    {LoopRenderStep::SEED, 0, 1, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::RECORD, 9600, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::SET_LENGTH, 0, 9600, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::OVERDUB, 9600, 0, 0, 0, 0.8f, 0.5f, 0.f},
+    {LoopRenderStep::SET_READ_POSITION, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ, 2400, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ_CLIP, 2400, 64, 0, 0, 0.25f, 0.5f, 0.f},
+    {LoopRenderStep::SEED, 0, 7, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ_RANDOM, 2400, 256, 0, 0, 0.5f, 0.5f, 0.f},
+    {LoopRenderStep::READ_SPEED, 2400, 0, 0, 0, 1.37f, 0.f, 0.f},
+    {LoopRenderStep::READ_SPEED, 2400, 0, 0, 0, -0.61f, 0.f, 0.f},
+    {LoopRenderStep::SET_CROSSFADE, 0, 64, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ_SPEED_CLIP, 2400, 64, 0, 0, 0.1f, 0.3f, 1.5f},
+    {LoopRenderStep::SET_CROSSFADE, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ_PHASE, 2400, 0, 0, 0, 0.75f, 0.f, 0.f},
+    {LoopRenderStep::SPLICE, 0, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ, 4800, 0, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::SPLICE, 0, 500, 1000, 8000, 0.f, 0.f, 0.f},
+    {LoopRenderStep::SET_LENGTH, 0, 6000, 0, 0, 0.f, 0.f, 0.f},
+    {LoopRenderStep::READ_SPEED, 2400, 0, 0, 0, 2.2f, 0.f, 0.f},
+    {LoopRenderStep::READ_CLIP, 2400, 64, 0, 0, 0.6f, 0.2f, 0.f},
+};
+
+static const size_t golden_steps = sizeof(golden_script) / sizeof(golden_script[0]);
+
+static int Report(const char* what, const LoopRenderResult& r)
+{
+    printf("%-28s %s  %zu samples", what, r.ok ? "ok      " : "MISMATCH", r.samples);
+    if (r.mismatches > 0) {
+        printf(", %zu differ from %zu", r.mismatches, r.first_mismatch);
+    }
+    double sps = LoopRender<Buffer>::GetSamplesPerSecond(r);
+    printf(", %.1f Msamples/s (%.0fx real time)\n", sps * 1e-6, sps / 48000.0);
+    return r.ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    bool        update = false;
+    const char* path   = "golden/looprender.wav";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    LoopRender<Buffer> render;
+    int                failures = 0;
+
+    if (update) {
+        render.Init(&loop, 48);
+        failures += Report("golden written", render.Render(golden_script, golden_steps, render.PER_SAMPLE, path));
+        return failures > 0 ? 1 : 0;
+    }
+
+    size_t                steps;
+    const LoopRenderStep* script   = render.DefaultScript(steps);
+    const size_t          blocks[] = {1, 7, 48, 256};
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+        char what[64];
+        snprintf(what, sizeof(what), "block = per sample, %zu", blocks[b]);
+        render.Init(&loop, blocks[b]);
+        failures += Report(what, render.CompareModes(script, steps, scratch, sizeof(scratch) / sizeof(scratch[0])));
+    }
+
+    render.Init(&loop, 48);
+    failures += Report("per sample = golden", render.Compare(golden_script, golden_steps, render.PER_SAMPLE, path));
+    failures += Report("block = golden", render.Compare(golden_script, golden_steps, render.BLOCK, path));
+    if (failures > 0) {
+        printf("%d failed, golden file %s\n", failures, path);
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#ifndef DSY_LOOPTEST_H
+#define DSY_LOOPTEST_H
+#include <stdio.h>
+
+/** Minimal check for the host tests: LOOP_CHECK(condition) prints the failed condition and counts it,
+LoopTestResult() prints the total and returns the exit code of the test.
+*/
+static int loop_test_failures = 0;
+
+#define LOOP_CHECK(condition)                                                     \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            loop_test_failures++;                                                 \
+        }                                                                         \
+    } while (0)
+
+static inline int LoopTestResult(const char* name)
+{
+    printf("%s: %s (%d failed)\n", name, loop_test_failures == 0 ? "ok" : "FAILED", loop_test_failures);
+    return loop_test_failures == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,86 @@
+/** Host regression test of the splice range checks of LoopBuffer.
+The buffer is a LoopBufferView over memory followed by a guard band, so a fade past the end of the
+loop shows up as a changed guard even without a sanitizer.
+*/
+#include "looptest.h"
+#include "loopbuffer.h"
+
+using namespace daisysp;
+
+static const size_t kLength = 1000;
+static const size_t kGuard  = 64;
+static const float  kFill   = 0.5f;
+static const float  kMark   = 123.f;
+
+static float                  memory[kLength + kGuard];
+static LoopBufferView<float> loop;
+
+static void Fill()
+{
+    for (size_t i = 0; i < kLength + kGuard; i++) {
+        memory[i] = i < kLength ? kFill : kMark;
+    }
+    loop.Move(memory, kLength);
+    loop.SetLength(kLength);
+}
+
+static bool GuardIntact()
+{
+    for (size_t i = kLength; i < kLength + kGuard; i++) {
+        if (memory[i] != kMark) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Unchanged()
+{
+    for (size_t i = 0; i < kLength; i++) {
+        if (memory[i] != kFill) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    loop.Init(memory, kLength);
+
+    //the fade in would run past the end of the loop and the memory
+    Fill();
+    LOOP_CHECK(!loop.StartSplice(100, 950, 999));
+    LOOP_CHECK(!loop.IsSplicing());
+    loop.Splice(100, 950, 999);
+    LOOP_CHECK(GuardIntact());
+    LOOP_CHECK(Unchanged());
+
+    //the start point after the end point
+    Fill();
+    LOOP_CHECK(!loop.StartSplice(100, 600, 400));
+    loop.Splice(100, 600, 400);
+    LOOP_CHECK(Unchanged());
+
+    //the largest start point that fits runs, and stays inside the loop
+    Fill();
+    LOOP_CHECK(loop.StartSplice(100, 900, 999));
+    while (loop.IsSplicing()) {
+        loop.SpliceStep(37);
+    }
+    LOOP_CHECK(GuardIntact());
+    LOOP_CHECK(memory[900] == 0.f);
+
+    //the whole loop, as Splice() does it
+    Fill();
+    LOOP_CHECK(!loop.StartSplice()); //a 1000 sample loop is too short for kSpliceFade at both ends
+    loop.SetLength(kLength);
+    LOOP_CHECK(loop.StartSplice(50, 0, kLength - 1));
+    while (loop.IsSplicing()) {
+        loop.SpliceStep(64);
+    }
+    LOOP_CHECK(GuardIntact());
+    LOOP_CHECK(memory[0] == 0.f && memory[kLength - 1] == 0.f);
+
+    return LoopTestResult("splice_test");
+}